@@ -10,18 +10,32 @@
  */
 
 /* .C calls */
-extern void bicriterion_iterated_local_search_call(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void dispersion_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void distance_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void kmeans_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
-extern void fast_kmeans_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *);
+extern void bicriterion_iterated_local_search_call(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void cannot_link_init_partitions(void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void dispersion_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void distance_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void kmeans_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void exact_coloring(void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void fast_kmeans_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void knn_dispersion_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void must_link_distances(void *, void *, void *, void *, void *, void *, void *);
+extern void must_link_init_partitions(void *, void *, void *, void *, void *, void *, void *, void *);
+extern void must_link_kmeans_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+extern void sparse_distance_anticlustering(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
 
 static const R_CMethodDef CEntries[] = {
-  {"bicriterion_iterated_local_search_call", (DL_FUNC) &bicriterion_iterated_local_search_call,  14},
-  {"dispersion_anticlustering",              (DL_FUNC) &dispersion_anticlustering,               9},
-  {"distance_anticlustering",                (DL_FUNC) &distance_anticlustering,                 14},
-  {"kmeans_anticlustering",                  (DL_FUNC) &kmeans_anticlustering,                  11},
-  {"fast_kmeans_anticlustering",                  (DL_FUNC) &fast_kmeans_anticlustering,         8},
+  {"bicriterion_iterated_local_search_call", (DL_FUNC) &bicriterion_iterated_local_search_call,  32},
+  {"cannot_link_init_partitions",            (DL_FUNC) &cannot_link_init_partitions,             9},
+  {"dispersion_anticlustering",              (DL_FUNC) &dispersion_anticlustering,              13},
+  {"distance_anticlustering",                (DL_FUNC) &distance_anticlustering,                 20},
+  {"kmeans_anticlustering",                  (DL_FUNC) &kmeans_anticlustering,                  14},
+  {"exact_coloring",                         (DL_FUNC) &exact_coloring,                          9},
+  {"fast_kmeans_anticlustering",                  (DL_FUNC) &fast_kmeans_anticlustering,         11},
+  {"knn_dispersion_anticlustering",          (DL_FUNC) &knn_dispersion_anticlustering,          14},
+  {"must_link_distances",                    (DL_FUNC) &must_link_distances,                     7},
+  {"must_link_init_partitions",              (DL_FUNC) &must_link_init_partitions,               8},
+  {"must_link_kmeans_anticlustering",        (DL_FUNC) &must_link_kmeans_anticlustering,        10},
+  {"sparse_distance_anticlustering",         (DL_FUNC) &sparse_distance_anticlustering,         19},
   {NULL, NULL, 0}
 };
 
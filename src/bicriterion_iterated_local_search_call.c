@@ -3,58 +3,83 @@
 #include <math.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
 #include "header.h"
+#include <time.h>
 #include <R.h>
-
-//datastructure to store a linked-list of partitions
-struct Pareto_element { 
-  double diversity; 
-  double dispersion;
-  int *partition;
-  struct Pareto_element *next;
-};
+#include <Rinternals.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 //receive data from r, call bils algorithm, save results for r
 void bicriterion_iterated_local_search_call(double *distances, 
                                             double *disp_distances,
+                                            int *use_disp_distances,
+                                            int *use_features,
+                                            double *features,
+                                            int *M,
                                             int *N, int *R, 
                                             int *upper_bound, int *WL, double *W, double *Xi, 
                                             int *partition,
                                             int *frequencies, // frequency of each partition
                                             int *use_init_partitions,
                                             int *init_partitions,
+                                            int *threads,
+                                            int *use_exchange_partners,
+                                            int *partners,
+                                            int *k_neighbours,
+                                            int *use_cannot_link,
+                                            int *CL_PTR,
+                                            int *CL_IDX,
+                                            int *all_weights,
+                                            double *time_limit,
+                                            double *max_evaluations,
                                             int *result,
+                                            double *result_diversity,
+                                            double *result_dispersion,
+                                            int *n_partitions,
+                                            int *stopped,
                                             int *mem_error
                                            ) {
   
   const size_t n = *N; // number of elements
-  const size_t u = *upper_bound; //max. length of result-list
+  const size_t u = *upper_bound; //max. number of partitions that are returned
   const size_t wl = *WL; // length of possible weights
   
-  int distance_ptr[n]; // indexing columns
-  double distance_pts[n][n];
+  // The distance matrices are read in place from R's memory (N x N, column major;
+  // because distances are symmetric, matrix[i * N + j] is the distance between i and j).
+  // If the dispersion is based on the same distances as the diversity, only one
+  // matrix is passed from R, which is then used for both criteria. If features are
+  // used instead (N x M, row major), no distance matrix is needed: the diversity 
+  // (i.e., the average diversity based on squared Euclidean distances) is computed 
+  // from the cluster centroids, and the dispersion distances are computed on demand.
+  struct bils_distances dist = {
+    .N = *N,
+    .M = *use_features ? *M : 0,
+    .matrix = *use_features ? NULL : distances,
+    .matrix2 = *use_features ? NULL : (*use_disp_distances ? disp_distances : distances),
+    .features = *use_features ? features : NULL
+  };
   
-  // Column offsets (to convert one-dimensional array to Row/Col major)
-  for (size_t i = 0; i < n; i++) {
-     distance_ptr[i] = i * n;
-  }
-  
-  // Reconstruct the data points as N x N matrix
-  for (size_t i = 0; i < n; i++) {
-    for (size_t j = 0; j < n; j++) {
-      distance_pts[i][j] = distances[distance_ptr[j]++];
-    }
-  }
+  // If exchange partners are used, the local search only swaps elements with their 
+  // exchange partners (`k_neighbours` per element, the value N indicates that no 
+  // more exchange partners follow); otherwise, all pairs of elements are swapped
+  int *exchange_partners = *use_exchange_partners ? partners : NULL;
+  const size_t k_partners = *use_exchange_partners ? *k_neighbours : 0;
   
-  // Create another distance matrix if dispersion is based on other distance (I.E., use BILS-E)
-  // this *always* duplicates memory, but I guess this is not so bad because the algo is slow anyway for large N
-  for (size_t i = 0; i < n; i++) {
-    distance_ptr[i] = i * n; // not sure if this must be re-initialized
-  }
-  double disp_distance_pts[n][n];
+  // If cannot-link constraints are used, swaps that violate a constraint are not 
+  // conducted (neither in the local search nor in the perturbation). The initial 
+  // partitions must satisfy the constraints, so no random initial partitions are 
+  // generated in this case (i.e., init_partitions should be passed)
+  struct cannot_link constraints = { .PTR = CL_PTR, .IDX = CL_IDX };
+  struct cannot_link *cannot_link = *use_cannot_link ? &constraints : NULL;
+
+  // Number of clusters (all partitions use the labels 0, ..., K-1)
+  size_t k = 0;
   for (size_t i = 0; i < n; i++) {
-    for (size_t j = 0; j < n; j++) {
-      disp_distance_pts[i][j] = disp_distances[distance_ptr[j]++];
+    if ((size_t) partition[i] + 1 > k) {
+      k = partition[i] + 1;
     }
   }
 
@@ -67,245 +92,612 @@ void bicriterion_iterated_local_search_call(double *distances,
   neighbor_percent[0] = Xi[0];
   neighbor_percent[1] = Xi[1];
   
-  struct Pareto_element* head = multistart_bicriterion_pairwise_interchange(n, 
-            distance_pts, 
-            disp_distance_pts,
+  struct pareto_archive *archive = allocate_pareto_archive(n, 64);
+  if (archive == NULL) {
+    *mem_error = 1;
+    return;
+  }
+  
+  // Random numbers are generated in C, the generator is seeded from R's RNG
+  struct rng_state rng;
+  seed_rng(&rng);
+  
+  // The search stops early if the time limit or the maximum number of evaluated 
+  // swaps is exceeded (values <= 0 indicate that there is no limit), or if the user 
+  // interrupts; the current Pareto set is then returned
+  struct bils_budget budget = {
+    .time_limit = *time_limit,
+    .max_evaluations = *max_evaluations,
+    .start = bils_wall_time(),
+    .evaluations = 0,
+    .next_interrupt_check = 0,
+    .stop = BILS_RUNNING
+  };
+  
+  int status = multistart_bicriterion_pairwise_interchange(archive, &rng, &budget, n, k,
+            &dist, 
             R[0], 
             wl, 
             weights, 
             partition,
             frequencies,
             use_init_partitions,
-            init_partitions
+            init_partitions,
+            exchange_partners,
+            k_partners,
+            cannot_link,
+            *all_weights,
+            *threads
   );
-  if (head == NULL) {
-    *mem_error = 1; // return after memory allocation error
-    return;
+  if (status == 0 && budget.stop == BILS_RUNNING) {
+    status = bicriterion_iterated_local_search(
+      archive, &rng, &budget, n, k,
+      &dist, 
+      R[1], wl, 
+      weights, neighbor_percent,
+      frequencies,
+      exchange_partners,
+      k_partners,
+      cannot_link,
+      *all_weights,
+      *threads
+    );
   }
-  head = bicriterion_iterated_local_search(
-    head, n, 
-    distance_pts, 
-    disp_distance_pts,
-    R[1], wl, 
-    weights, neighbor_percent,
-    frequencies
-  );
-  if (head == NULL) {
+  if (status == 1) {
+    free_pareto_archive(archive);
     *mem_error = 1; // return after memory allocation error
     return;
   }
   
-  //fill result with -1 to identify the last partition in the matrix
-  for (size_t i = 0; i < n*u; i++){
-    result[i] = -1;
-  }
-  //update result with the solutions from the linked list
-  size_t position = 0;
-  struct Pareto_element* tmp = head; // for freeing memory lateron
-  while (head != NULL && position != n*u) {
-    for (size_t i = 0; i < n; i++){
-      result[position] = head->partition[i];
-      position++;
-    }
-    head = head->next;
-  } 
-  free_pareto_set(tmp);
+  *n_partitions = pareto_results(archive, u, result, result_diversity, result_dispersion);
+  *stopped = budget.stop;
+  free_pareto_archive(archive);
   return;
 }
 
-// function to free all memory allocated by the pareto set
-void free_pareto_set(struct Pareto_element* head) {
-  struct Pareto_element* tmp; // for freeing memory
-  while (head != NULL) {
-    tmp = head;
-    head = head->next;
-    free(tmp->partition);
-    free(tmp);
+// Write the partitions in the Pareto set and their objectives to the result arrays. 
+// The archive only contains distinct partitions (see `update_pareto()`). If there are
+// more than `u` partitions, `u` partitions evenly spread across the Pareto set (which 
+// is sorted by diversity) are returned. Returns the number of partitions
+int pareto_results(struct pareto_archive *archive, size_t u, int *result, 
+                   double *result_diversity, double *result_dispersion) {
+  const size_t n = archive->N;
+  size_t n_selected = archive->size < u ? archive->size : u;
+  for (size_t s = 0; s < n_selected; s++) {
+    size_t e = s;
+    if (archive->size > u) {
+      e = u == 1 ? archive->size - 1 : (s * (archive->size - 1)) / (u - 1);
+    }
+    memcpy(&result[s * n], &archive->PARTITIONS[archive->SLOT[e] * n], sizeof(int) * n);
+    result_diversity[s] = archive->DIVERSITY[e];
+    result_dispersion[s] = archive->DISPERSION[e];
   }
-  return;
+  return (int) n_selected;
 }
 
-// returns the HEAD to a pareto set (linked list); if it returns NULL, a memory allocation error occurred
-struct Pareto_element* multistart_bicriterion_pairwise_interchange(
+// returns 1 if a memory allocation error occurred, 0 otherwise
+int multistart_bicriterion_pairwise_interchange(
+    struct pareto_archive *archive,
+    struct rng_state *rng,
+    struct bils_budget *budget,
     size_t N, 
-    double matrix[N][N], 
-    double matrix2[N][N], 
+    size_t K,
+    struct bils_distances *distances,
     size_t R, 
     size_t WL, 
     double weights[WL], 
     int *partition, int *frequencies, 
-    int *use_init_partitions, int *init_partitions) {
-  
-  struct Pareto_element* head = NULL; // head pointing on the later linked list(paretoset)
+    int *use_init_partitions, int *init_partitions,
+    int *partners, size_t k_partners,
+    struct cannot_link *cannot_link,
+    bool all_weights,
+    int threads) {
   
-  size_t partition_counter = 0;
+  // Each repetition has its own random number generator (seeded from the main 
+  // generator), so the results do not depend on the number of threads
+  uint64_t *SEEDS = (uint64_t*) malloc(sizeof(uint64_t) * R);
+  struct bils_worker *workers = allocate_bils_workers(threads, N, K, distances->M, all_weights ? WL : 0);
+  if (SEEDS == NULL || workers == NULL) {
+    free(SEEDS);
+    if (workers != NULL) {
+      free_bils_workers(threads, workers);
+    }
+    return 1;
+  }
+  for (size_t a = 0; a < R; a++) {
+    SEEDS[a] = next_random(rng);
+  }
   
+  int status = 0;
+  #ifdef _OPENMP
+  #pragma omp parallel for num_threads(threads) schedule(dynamic)
+  #endif
   for (size_t a = 0; a < R; a++) {
+    // after the search was stopped, the remaining repetitions are skipped (the 
+    // first repetition is always conducted, so the Pareto set is never empty; 
+    // R >= 1 has to be guaranteed by the caller)
+    int stop;
+    #ifdef _OPENMP
+    #pragma omp atomic read
+    #endif
+    stop = budget->stop;
+    if (a > 0 && stop != BILS_RUNNING) {
+      continue;
+    }
+    struct bils_worker *worker = &workers[bils_thread_id()];
+    struct rng_state rng_a;
+    seed_rng_from(&rng_a, SEEDS[a]);
     if (*use_init_partitions == 0) {
-      if (a > 0) {
-        shuffle_permutation(N, partition);
+      memcpy(worker->partition, partition, sizeof(int) * N);
+      if (a > 0 && cannot_link == NULL) {
+        shuffle_permutation(&rng_a, N, worker->partition);
       }
     } else {
-      for (size_t i = 0; i < N; i++) {
-        partition[i] = init_partitions[partition_counter];
-        partition_counter++;
-      }
+      memcpy(worker->partition, &init_partitions[a * N], sizeof(int) * N);
     }
+    int search_status;
+    if (all_weights) {
+      search_status = bils_local_search_all_weights(worker, budget, N, K, distances, 
+                                                    WL, weights, frequencies, partners, k_partners,
+                                                    cannot_link);
+    } else {
+      double div_weight = sample(&rng_a, WL, weights); 
+      search_status = bils_local_search(worker, budget, N, K, distances, div_weight, 
+                                        frequencies, partners, k_partners, cannot_link);
+    }
+    if (search_status == 1) {
+      #ifdef _OPENMP
+      #pragma omp atomic write
+      #endif
+      status = 1;
+    }
+  }
+  if (status == 0) {
+    status = merge_bils_workers(archive, threads, workers);
+  }
+  free(SEEDS);
+  free_bils_workers(threads, workers);
+  return status;
+}  
 
+// returns 1 if a memory allocation error occurred, 0 otherwise
+int bicriterion_iterated_local_search(
+    struct pareto_archive *archive, struct rng_state *rng, struct bils_budget *budget,
+    size_t N, size_t K, struct bils_distances *distances, size_t R, 
+    size_t WL, double weights[WL], double neighbor_percent[2], int *frequencies,
+    int *partners, size_t k_partners, struct cannot_link *cannot_link, 
+    bool all_weights, int threads){
 
-    double div_weight = sample(WL, weights); 
-    double dis_weight = 1 - div_weight;
-    double diversity = get_diversity(N, partition, matrix, frequencies);
-    double save_diversity = diversity;
-    double dispersion = get_dispersion(N, partition, matrix2);
-    double save_dispersion = dispersion;
-    double max_bicriterion = div_weight*diversity + dis_weight*dispersion;
-    
-    //initialize Pareto set
-    update_pareto(&head, N, partition, diversity, dispersion);
-    
-    bool Flag = false;
-    while(!Flag){
-      Flag = true;
-      for (size_t i = 0; i < N-1; i++){
-        for (size_t j = i+1; j < N; j++){
-          int g = partition[i];
-          int h = partition[j];
-          if(g != h){
-            cluster_swap(i, j, partition);
-            double current_diversity = get_diversity_fast(save_diversity, i, j, N, partition, matrix, frequencies);
-            double current_dispersion = get_dispersion_fast(save_dispersion , i, j, N, partition, matrix2);
-            if (update_pareto(&head, N, partition,current_diversity, current_dispersion) == 1) {
-                free_pareto_set(head); // free all memory
-                return NULL;
-            }
-            double current_bicriterion = div_weight*current_diversity + dis_weight*current_dispersion;
-            if(current_bicriterion > max_bicriterion){
-              save_diversity = current_diversity;
-              save_dispersion = current_dispersion;
-              max_bicriterion = current_bicriterion;
-              Flag = false;
-            }else{
-              cluster_swap(i, j, partition);
-            }
-          }
-        }
+  struct bils_worker *workers = allocate_bils_workers(threads, N, K, distances->M, all_weights ? WL : 0);
+  if (workers == NULL) {
+    return 1;
+  }
+  
+  // The repetitions are conducted in rounds of `threads` repetitions. Within a 
+  // round, all repetitions sample from the same Pareto set; the local Pareto sets 
+  // of the threads are merged into the global Pareto set after each round
+  int status = 0;
+  uint64_t SEEDS[threads];
+  for (size_t start = 0; start < R && status == 0 && budget->stop == BILS_RUNNING; start += threads) {
+    size_t end = start + threads < R ? start + threads : R;
+    for (size_t a = start; a < end; a++) {
+      SEEDS[a - start] = next_random(rng);
+    }
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+    #endif
+    for (size_t a = start; a < end; a++) {
+      struct bils_worker *worker = &workers[bils_thread_id()];
+      struct rng_state rng_a;
+      seed_rng_from(&rng_a, SEEDS[a - start]);
+      double div_weight = all_weights ? 0 : sample(&rng_a, WL, weights); 
+      double neighborhood_size = uni_rnd_number_range(&rng_a, neighbor_percent[0], neighbor_percent[1]);
+      pareto_sample(&rng_a, archive, worker->partition);
+      perturb_partition(&rng_a, N, worker->partition, neighborhood_size, cannot_link);
+      int search_status;
+      if (all_weights) {
+        search_status = bils_local_search_all_weights(worker, budget, N, K, distances, 
+                                                      WL, weights, frequencies, partners, k_partners,
+                                                      cannot_link);
+      } else {
+        search_status = bils_local_search(worker, budget, N, K, distances, div_weight, 
+                                          frequencies, partners, k_partners, cannot_link);
       }
+      if (search_status == 1) {
+        #ifdef _OPENMP
+        #pragma omp atomic write
+        #endif
+        status = 1;
+      }
+    }
+    if (status == 0) {
+      status = merge_bils_workers(archive, threads, workers);
     }
   }
-  return (head);
-}  
+  free_bils_workers(threads, workers);
+  return status;
+}     
 
-// returns the HEAD to a pareto set (linked list); if it returns NULL, a memory allocation error occurred
-struct Pareto_element* bicriterion_iterated_local_search(
-    struct Pareto_element* head, size_t N, double matrix[N][N], 
-    double matrix2[N][N], size_t R, 
-    size_t WL, double weights[WL], double neighbor_percent[2], int *frequencies){
-
-  for (size_t a = 0; a < R; a++){
-    double div_weight = sample(WL, weights); 
-    double dis_weight = 1 - div_weight;
-    double neighborhood_size = uni_rnd_number_range(neighbor_percent[0], neighbor_percent[1]);
-    int* partition = (int*) malloc(sizeof(int) * N);
-    linked_list_sample(head, N, partition);
-    for (size_t i = 0; i < N-1; i++){
-      for (size_t j = i + 1; j < N; j++){
+// Local search (pairwise interchange) on the partition of the worker, maximizing 
+// the weighted sum of diversity and dispersion. All partitions that are evaluated are 
+// inserted into the Pareto set of the worker. If `partners` is not NULL, each element 
+// is only swapped with its `k_partners` exchange partners; otherwise, all pairs of
+// elements are swapped. Swaps that violate a cannot-link constraint are skipped 
+// (`cannot_link` is NULL if no constraints are used). The search ends early if the 
+// budget is exhausted (checked after each element).
+// Returns 1 if a memory allocation error occurred, 0 otherwise
+int bils_local_search(struct bils_worker *worker, struct bils_budget *budget, size_t N, 
+                      size_t K, struct bils_distances *distances, double div_weight, 
+                      int *frequencies, int *partners, size_t k_partners, 
+                      struct cannot_link *cannot_link){
+  struct bils_data *data = worker->data;
+  int *partition = worker->partition;
+  double dis_weight = 1 - div_weight;
+  initialize_bils_data(N, K, partition, distances, data);
+  double diversity = bils_diversity(N, K, partition, distances, frequencies);
+  double save_diversity = diversity;
+  double dispersion = array_min(K, data->CLUSTER_DISPERSIONS);
+  double max_bicriterion = div_weight*diversity + dis_weight*dispersion;
+  
+  if (update_pareto(worker->archive, partition, diversity, dispersion) == 1) {
+    return 1;
+  }
+  
+  bool Flag = false;
+  while(!Flag){
+    Flag = true;
+    for (size_t i = 0; i < N; i++){
+      size_t n_partners = partners == NULL ? N - 1 - i : k_partners;
+      for (size_t u = 0; u < n_partners; u++){
+        size_t j = partners == NULL ? i + 1 + u : (size_t) partners[i * k_partners + u];
+        if (j == N) { // no exchange partners any more
+          n_partners = u;
+          break;
+        }
         int g = partition[i];
         int h = partition[j];
-        if (g != h){
-          double random = uni_rnd_number_range(0,1);
-          if(random < neighborhood_size){
+        if(g != h && !cannot_link_violated(i, j, partition, cannot_link)){
+          double current_diversity = save_diversity + 
+            bils_diversity_change(i, j, g, h, N, K, distances, data, frequencies);
+          double current_dispersion = dispersion_swap_value(i, j, g, h, K, distances, data);
+          cluster_swap(i, j, partition);
+          if (update_pareto(worker->archive, partition, current_diversity, current_dispersion) == 1) {
+            return 1;
+          }
+          double current_bicriterion = div_weight*current_diversity + dis_weight*current_dispersion;
+          if(current_bicriterion > max_bicriterion){
+            save_diversity = current_diversity;
+            max_bicriterion = current_bicriterion;
+            update_bils_data(i, j, g, h, N, K, distances, data);
+            Flag = false;
+          }else{
             cluster_swap(i, j, partition);
           }
         }
       }
+      if (bils_budget_exhausted(budget, n_partners)) {
+        return 0;
+      }
     }
-    double diversity = get_diversity(N, partition, matrix, frequencies);
-    double save_diversity = diversity;
-    double dispersion = get_dispersion(N, partition, matrix2);
-    double save_dispersion = dispersion;
-    double max_bicriterion = div_weight*diversity + dis_weight*dispersion;
-    bool Flag = false;
-    while(!Flag){
-      Flag = true;
-      for (size_t i = 0; i < N-1; i++){
-        for (size_t j = i+1; j < N; j++){
-          int g = partition[i];
-          int h = partition[j];
-          if(g != h){
-            cluster_swap(i, j, partition);
-            double current_diversity = get_diversity_fast(save_diversity, i, j, N, partition, matrix, frequencies);
-            double current_dispersion = get_dispersion_fast(save_dispersion , i, j, N, partition, matrix2);
-            if (update_pareto(&head, N, partition, current_diversity, current_dispersion) == 1) {
-                free_pareto_set(head); // free all memory
-                free(partition);
-                return NULL;
+  }
+  return 0;
+}
+
+// Local search that maximizes the weighted sum of diversity and dispersion for all
+// weights at the same time, starting from the partition of the worker. Each weight 
+// has its own incumbent partition; weights that share the same incumbent (initially, 
+// all weights) form a track, and each swap is only evaluated once per track. When 
+// a swap improves the incumbent for some (but not all) weights of a track, these 
+// weights continue on a copy of the track. For each weight, the sequence of swaps 
+// is the same as in `bils_local_search()` using this weight.
+// Returns 1 if a memory allocation error occurred, 0 otherwise
+int bils_local_search_all_weights(struct bils_worker *worker, struct bils_budget *budget, 
+                                  size_t N, size_t K, struct bils_distances *distances, 
+                                  size_t WL, double weights[WL], int *frequencies, 
+                                  int *partners, size_t k_partners, 
+                                  struct cannot_link *cannot_link){
+  struct bils_track *tracks = worker->tracks;
+  size_t TRACK[WL]; // track of each weight
+  double MAX_BICRITERION[WL];
+  
+  memcpy(tracks[0].partition, worker->partition, sizeof(int) * N);
+  initialize_bils_data(N, K, tracks[0].partition, distances, tracks[0].data);
+  tracks[0].diversity = bils_diversity(N, K, tracks[0].partition, distances, frequencies);
+  tracks[0].converged = false;
+  size_t n_tracks = 1;
+  double dispersion = array_min(K, tracks[0].data->CLUSTER_DISPERSIONS);
+  for (size_t w = 0; w < WL; w++) {
+    TRACK[w] = 0;
+    MAX_BICRITERION[w] = weights[w]*tracks[0].diversity + (1-weights[w])*dispersion;
+  }
+  if (update_pareto(worker->archive, tracks[0].partition, tracks[0].diversity, dispersion) == 1) {
+    return 1;
+  }
+  
+  bool Flag = false;
+  while(!Flag){
+    for (size_t t = 0; t < n_tracks; t++) {
+      tracks[t].changed = false;
+    }
+    for (size_t i = 0; i < N; i++){
+      size_t n_partners = partners == NULL ? N - 1 - i : k_partners;
+      size_t evaluations = 0;
+      for (size_t u = 0; u < n_partners; u++){
+        size_t j = partners == NULL ? i + 1 + u : (size_t) partners[i * k_partners + u];
+        if (j == N) { // no exchange partners any more
+          break;
+        }
+        // tracks that are created during this swap already contain the swap
+        size_t n_current = n_tracks;
+        for (size_t t = 0; t < n_current; t++) {
+          struct bils_track *track = &tracks[t];
+          int g = track->partition[i];
+          int h = track->partition[j];
+          if (track->converged || g == h || 
+              cannot_link_violated(i, j, track->partition, cannot_link)) {
+            continue;
+          }
+          evaluations++;
+          double current_diversity = track->diversity + 
+            bils_diversity_change(i, j, g, h, N, K, distances, track->data, frequencies);
+          double current_dispersion = dispersion_swap_value(i, j, g, h, K, distances, track->data);
+          cluster_swap(i, j, track->partition);
+          if (update_pareto(worker->archive, track->partition, current_diversity, current_dispersion) == 1) {
+            return 1;
+          }
+          size_t n_improved = 0, n_weights = 0;
+          for (size_t w = 0; w < WL; w++) {
+            if (TRACK[w] == t) {
+              n_weights++;
+              if (weights[w]*current_diversity + (1-weights[w])*current_dispersion > MAX_BICRITERION[w]) {
+                n_improved++;
+              }
             }
-            double current_bicriterion = div_weight*current_diversity + dis_weight*current_dispersion;
-            if(current_bicriterion > max_bicriterion){
-              save_diversity = current_diversity;
-              save_dispersion = current_dispersion;
-              max_bicriterion = current_bicriterion;
-              Flag = false;
-            }else{
-              cluster_swap(i, j, partition);
+          }
+          if (n_improved == 0) {
+            cluster_swap(i, j, track->partition);
+            continue;
+          }
+          // if only some weights improve, they continue on a copy of the track
+          struct bils_track *improved = track;
+          size_t improved_id = t;
+          if (n_improved < n_weights) {
+            improved_id = n_tracks++;
+            improved = &tracks[improved_id];
+            memcpy(improved->partition, track->partition, sizeof(int) * N);
+            copy_bils_data(N, K, track->data, improved->data);
+            cluster_swap(i, j, track->partition);
+          }
+          for (size_t w = 0; w < WL; w++) {
+            double current_bicriterion = weights[w]*current_diversity + (1-weights[w])*current_dispersion;
+            if (TRACK[w] == t && current_bicriterion > MAX_BICRITERION[w]) {
+              TRACK[w] = improved_id;
+              MAX_BICRITERION[w] = current_bicriterion;
             }
           }
+          improved->diversity = current_diversity;
+          improved->changed = true;
+          improved->converged = false;
+          update_bils_data(i, j, g, h, N, K, distances, improved->data);
         }
       }
+      if (bils_budget_exhausted(budget, evaluations)) {
+        return 0;
+      }
+    }
+    // tracks that did not change during a sweep are local maxima for their weights
+    Flag = true;
+    for (size_t t = 0; t < n_tracks; t++) {
+      if (!tracks[t].changed) {
+        tracks[t].converged = true;
+      }
+      Flag = Flag && tracks[t].converged;
     }
-    free(partition);
   }
-  return (head);
-}     
+  return 0;
+}
 
-//sample functin from R. Get one random element from an array
-double sample(size_t array_size, double array[array_size]) {
-  int max = (int) array_size;
-  int r = random_integer(0, max-1);
-  return(array[r]);
+// Count `evaluations` additional swaps and check whether the search has to stop 
+// because the time limit or the maximum number of evaluations is exceeded, or 
+// because the user interrupted. Only the main thread checks for user interrupts, 
+// because the R API must not be called from other threads. 
+bool bils_budget_exhausted(struct bils_budget *budget, size_t evaluations){
+  double total;
+  #ifdef _OPENMP
+  #pragma omp atomic capture
+  #endif
+  total = budget->evaluations += evaluations;
+  int stop;
+  #ifdef _OPENMP
+  #pragma omp atomic read
+  #endif
+  stop = budget->stop;
+  if (stop != BILS_RUNNING) {
+    return true;
+  }
+  if (budget->max_evaluations > 0 && total >= budget->max_evaluations) {
+    stop = BILS_BUDGET_EXHAUSTED;
+  } else if (budget->time_limit > 0 && bils_wall_time() - budget->start >= budget->time_limit) {
+    stop = BILS_BUDGET_EXHAUSTED;
+  } else if (bils_thread_id() == 0 && total >= budget->next_interrupt_check) {
+    budget->next_interrupt_check = total + BILS_INTERRUPT_INTERVAL;
+    if (bils_interrupt_pending()) {
+      stop = BILS_INTERRUPTED;
+    }
+  }
+  if (stop != BILS_RUNNING) {
+    #ifdef _OPENMP
+    #pragma omp atomic write
+    #endif
+    budget->stop = stop;
+    return true;
+  }
+  return false;
 }
 
-double get_diversity(size_t N, int* partition, double matrix[N][N], int *frequencies){
-  
-  double sum = 0;
-  
-  for (size_t i = 0; i < N-1; i++){
-    for (size_t j = i+1; j < N; j++){
-      if (partition[i] == partition[j]){
-        sum = sum + matrix[i][j] / frequencies[partition[i]];
+// R_CheckUserInterrupt() does not return if the user interrupted; calling it via
+// R_ToplevelExec() allows to stop the search and to free the memory
+static void bils_check_interrupt(void *dummy){
+  R_CheckUserInterrupt();
+}
+
+bool bils_interrupt_pending(void){
+  return !R_ToplevelExec(bils_check_interrupt, NULL);
+}
+
+// Wall clock time in seconds (without OpenMP, only one thread is used and the
+// processor time is used instead)
+double bils_wall_time(void){
+  #ifdef _OPENMP
+  return omp_get_wtime();
+  #else
+  return (double) clock() / CLOCKS_PER_SEC;
+  #endif
+}
+
+// Allocate the data structures used by each thread (including `n_tracks` tracks 
+// for the local search using all weights); returns NULL if a memory allocation 
+// error occurred
+struct bils_worker* allocate_bils_workers(int threads, size_t N, size_t K, size_t M, 
+                                          size_t n_tracks){
+  struct bils_worker *workers = (struct bils_worker*) malloc(sizeof(struct bils_worker) * threads);
+  if (workers == NULL) {
+    return NULL;
+  }
+  int failed = 0;
+  for (int t = 0; t < threads; t++) {
+    workers[t].data = allocate_bils_data(N, K, M);
+    workers[t].archive = allocate_pareto_archive(N, 64);
+    workers[t].partition = (int*) malloc(sizeof(int) * N);
+    workers[t].n_tracks = n_tracks;
+    workers[t].tracks = (struct bils_track*) calloc(n_tracks, sizeof(struct bils_track));
+    if (workers[t].data == NULL || workers[t].archive == NULL || workers[t].partition == NULL ||
+        (n_tracks > 0 && workers[t].tracks == NULL)) {
+      failed = 1;
+      continue;
+    }
+    for (size_t i = 0; i < n_tracks; i++) {
+      workers[t].tracks[i].data = allocate_bils_data(N, K, M);
+      workers[t].tracks[i].partition = (int*) malloc(sizeof(int) * N);
+      if (workers[t].tracks[i].data == NULL || workers[t].tracks[i].partition == NULL) {
+        failed = 1;
       }
     }
   }
-  
-  return(sum);  
+  if (failed) {
+    free_bils_workers(threads, workers);
+    return NULL;
+  }
+  return workers;
 }
 
+void free_bils_workers(int threads, struct bils_worker *workers){
+  for (int t = 0; t < threads; t++) {
+    if (workers[t].data != NULL) {
+      free_bils_data(workers[t].data);
+    }
+    if (workers[t].archive != NULL) {
+      free_pareto_archive(workers[t].archive);
+    }
+    free(workers[t].partition);
+    if (workers[t].tracks != NULL) {
+      for (size_t i = 0; i < workers[t].n_tracks; i++) {
+        if (workers[t].tracks[i].data != NULL) {
+          free_bils_data(workers[t].tracks[i].data);
+        }
+        free(workers[t].tracks[i].partition);
+      }
+      free(workers[t].tracks);
+    }
+  }
+  free(workers);
+}
+
+// Insert the partitions of the workers' Pareto sets into the global Pareto set, and
+// empty the workers' Pareto sets. Returns 1 if a memory allocation error occurred
+int merge_bils_workers(struct pareto_archive *archive, int threads, struct bils_worker *workers){
+  for (int t = 0; t < threads; t++) {
+    struct pareto_archive *local = workers[t].archive;
+    for (size_t e = 0; e < local->size; e++) {
+      int *local_partition = &local->PARTITIONS[local->SLOT[e] * local->N];
+      if (update_pareto(archive, local_partition, local->DIVERSITY[e], local->DISPERSION[e]) == 1) {
+        return 1;
+      }
+      local->FREE_SLOTS[local->n_free++] = local->SLOT[e];
+    }
+    local->size = 0;
+  }
+  return 0;
+}
+
+int bils_thread_id(void){
+  #ifdef _OPENMP
+  return omp_get_thread_num();
+  #else
+  return 0;
+  #endif
+}
+
+// Swap each pair of elements in different clusters with probability `neighborhood_size`.
+// Instead of drawing a random number for each pair, the number of pairs that are skipped
+// until the next swap is drawn from a geometric distribution (pairs are visited in the
+// order (0, 1), (0, 2), ..., (N-2, N-1)), so only one random number is needed per swap.
+// Swaps that violate a cannot-link constraint are skipped
+void perturb_partition(struct rng_state *rng, size_t N, int* partition, double neighborhood_size,
+                       struct cannot_link *cannot_link){
+  if (neighborhood_size <= 0 || N < 2){
+    return;
+  }
+  double log_q = log1p(-neighborhood_size); // -Inf if neighborhood_size == 1 (no skipping)
+  size_t i = 0;
+  size_t j = 0; // the first pair is (0, 1) after the first skip
+  while (1){
+    double skip = floor(log(1 - uniform_rnd_number(rng)) / log_q);
+    // move forward by skip + 1 pairs; row i contains the pairs (i, i+1), ..., (i, N-1)
+    double remaining = skip + 1;
+    while (i < N - 1 && remaining > (double) (N - 1 - j)){
+      remaining -= N - 1 - j;
+      i++;
+      j = i;
+    }
+    if (i >= N - 1){
+      return;
+    }
+    j += (size_t) remaining;
+    if (partition[i] != partition[j] && !cannot_link_violated(i, j, partition, cannot_link)){
+      cluster_swap(i, j, partition);
+    }
+  }
+}
 
-double get_dispersion(size_t N, int* partition, double matrix[N][N]){
+//sample functin from R. Get one random element from an array
+double sample(struct rng_state *rng, size_t array_size, double array[array_size]) {
+  int max = (int) array_size;
+  int r = random_integer(rng, 0, max-1);
+  return(array[r]);
+}
+
+double get_diversity(size_t N, int* partition, double *matrix, int *frequencies){
   
-  double min = INFINITY;
-  double distance;
+  double sum = 0;
   
   for (size_t i = 0; i < N-1; i++){
     for (size_t j = i+1; j < N; j++){
       if (partition[i] == partition[j]){
-        distance = matrix[i][j];
-        if (distance < min){
-          min = distance;
-        }
+        sum = sum + matrix[i * N + j] / frequencies[partition[i]];
       }
     }
   }
   
-  return(min);
+  return(sum);  
 }
 
 
-// Fisher-Yates shuffle algorithm for shuffling ermutations
-void shuffle_permutation(int N, int *permutation) {
-    for (int i = 0; i <= N-2; i++) {
-        int j = random_integer(0, i);
+// Fisher-Yates shuffle algorithm for shuffling permutations (each element i is 
+// swapped with a random element among the elements 0, ..., i)
+void shuffle_permutation(struct rng_state *rng, int N, int *permutation) {
+    for (int i = N-1; i > 0; i--) {
+        int j = random_integer(rng, 0, i);
         cluster_swap(i, j, permutation);
     }
 }
@@ -317,241 +709,578 @@ void cluster_swap(size_t i, size_t j, int* partition){
 }
 
 
-int update_pareto(struct Pareto_element** head_ref, size_t N, int* partition, double diversity, double dispersion){
-  
-  if(*head_ref == NULL){
-    if (push(head_ref, diversity, dispersion, N, partition) == 1) {
-        return 1;
-    }
-    
+// returns NULL if a memory allocation error occurred
+struct pareto_archive* allocate_pareto_archive(size_t N, size_t capacity){
+  struct pareto_archive *archive = (struct pareto_archive*) malloc(sizeof(struct pareto_archive));
+  if (archive == NULL) {
+    return NULL;
   }
-  if (!(paretodominated(*head_ref, diversity, dispersion))) {
-      delete_outdated(head_ref, diversity, dispersion);
-      if (push(head_ref, diversity, dispersion, N, partition) == 1) {
-        return 1;
-      }
+  archive->N = N;
+  archive->size = 0;
+  archive->capacity = 0;
+  archive->n_free = 0;
+  archive->DIVERSITY = NULL;
+  archive->DISPERSION = NULL;
+  archive->HASH = NULL;
+  archive->SLOT = NULL;
+  archive->PARTITIONS = NULL;
+  archive->FREE_SLOTS = NULL;
+  archive->LABELS = (int*) malloc(sizeof(int) * N);
+  archive->RELABELED = (int*) malloc(sizeof(int) * N);
+  if (archive->LABELS == NULL || archive->RELABELED == NULL || 
+      grow_pareto_archive(archive, capacity) == 1) {
+    free_pareto_archive(archive);
+    return NULL;
   }
+  return archive;
+}
+
+// function to free all memory allocated by the pareto set
+void free_pareto_archive(struct pareto_archive *archive) {
+  free(archive->DIVERSITY);
+  free(archive->DISPERSION);
+  free(archive->HASH);
+  free(archive->SLOT);
+  free(archive->PARTITIONS);
+  free(archive->FREE_SLOTS);
+  free(archive->LABELS);
+  free(archive->RELABELED);
+  free(archive);
+}
+
+// Increase the number of partitions that can be stored; returns 1 if a memory 
+// allocation error occurs, 0 otherwise
+int grow_pareto_archive(struct pareto_archive *archive, size_t capacity) {
+  size_t N = archive->N;
+  double *DIVERSITY = (double*) realloc(archive->DIVERSITY, sizeof(double) * capacity);
+  if (DIVERSITY != NULL) archive->DIVERSITY = DIVERSITY;
+  double *DISPERSION = (double*) realloc(archive->DISPERSION, sizeof(double) * capacity);
+  if (DISPERSION != NULL) archive->DISPERSION = DISPERSION;
+  uint64_t *HASH = (uint64_t*) realloc(archive->HASH, sizeof(uint64_t) * capacity);
+  if (HASH != NULL) archive->HASH = HASH;
+  size_t *SLOT = (size_t*) realloc(archive->SLOT, sizeof(size_t) * capacity);
+  if (SLOT != NULL) archive->SLOT = SLOT;
+  int *PARTITIONS = (int*) realloc(archive->PARTITIONS, sizeof(int) * N * capacity);
+  if (PARTITIONS != NULL) archive->PARTITIONS = PARTITIONS;
+  size_t *FREE_SLOTS = (size_t*) realloc(archive->FREE_SLOTS, sizeof(size_t) * capacity);
+  if (FREE_SLOTS != NULL) archive->FREE_SLOTS = FREE_SLOTS;
+  if (DIVERSITY == NULL || DISPERSION == NULL || HASH == NULL || SLOT == NULL || 
+      PARTITIONS == NULL || FREE_SLOTS == NULL) {
+    return 1;
+  }
+  for (size_t s = capacity; s > archive->capacity; s--) {
+    archive->FREE_SLOTS[archive->n_free++] = s - 1;
+  }
+  archive->capacity = capacity;
   return 0;
 }
 
-bool paretodominated(struct Pareto_element* head, double diversity, double dispersion){
+// Insert a partition into the Pareto set if it is not dominated, and remove all
+// partitions that it dominates; returns 1 if a memory allocation error occurs, 0 otherwise.
+// The partition is stored in canonical form (see `relabel_partition()`), so partitions 
+// that only differ by their cluster labels are only stored once
+int update_pareto(struct pareto_archive *archive, int* partition, double diversity, double dispersion){
   
-  while(head != NULL){
-    if((head->diversity >= diversity && head->dispersion > dispersion) || (head->diversity > diversity && head->dispersion >= dispersion)){
-      return (true);
+  if (paretodominated(archive, diversity, dispersion)) {
+    return 0;
+  }
+  size_t N = archive->N;
+  relabel_partition(N, partition, archive->RELABELED, archive->LABELS);
+  partition = archive->RELABELED;
+  size_t upper = pareto_upper_bound(archive, diversity);
+  
+  // A duplicate has the same objectives, i.e., it is directly before `upper`
+  uint64_t hash = hash_partition(N, partition);
+  for (size_t e = upper; e > 0 && archive->DIVERSITY[e - 1] == diversity; e--) {
+    if (archive->DISPERSION[e - 1] == dispersion && archive->HASH[e - 1] == hash &&
+        memcmp(&archive->PARTITIONS[archive->SLOT[e - 1] * N], partition, sizeof(int) * N) == 0) {
+      return 0;
     }
-    head = head->next;
   }
   
+  // Only partitions with lower or equal diversity can be dominated by the new partition
+  size_t position = 0;
+  for (size_t e = 0; e < upper; e++) {
+    if ((diversity >= archive->DIVERSITY[e] && dispersion > archive->DISPERSION[e]) || 
+        (diversity > archive->DIVERSITY[e] && dispersion >= archive->DISPERSION[e])) {
+      archive->FREE_SLOTS[archive->n_free++] = archive->SLOT[e];
+    } else {
+      archive->DIVERSITY[position] = archive->DIVERSITY[e];
+      archive->DISPERSION[position] = archive->DISPERSION[e];
+      archive->HASH[position] = archive->HASH[e];
+      archive->SLOT[position] = archive->SLOT[e];
+      position++;
+    }
+  }
+  size_t n_after = archive->size - upper;
+  memmove(&archive->DIVERSITY[position], &archive->DIVERSITY[upper], sizeof(double) * n_after);
+  memmove(&archive->DISPERSION[position], &archive->DISPERSION[upper], sizeof(double) * n_after);
+  memmove(&archive->HASH[position], &archive->HASH[upper], sizeof(uint64_t) * n_after);
+  memmove(&archive->SLOT[position], &archive->SLOT[upper], sizeof(size_t) * n_after);
+  archive->size = position + n_after;
+  
+  if (archive->n_free == 0) {
+    if (grow_pareto_archive(archive, 2 * archive->capacity) == 1) {
+      return 1;
+    }
+  }
+  
+  // Partitions having the same objectives are ordered by their hash value, so the 
+  // order of the archive does not depend on the order in which partitions were inserted
+  while (position > 0 && archive->DIVERSITY[position - 1] == diversity && 
+         (archive->HASH[position - 1] > hash || (archive->HASH[position - 1] == hash && 
+          memcmp(&archive->PARTITIONS[archive->SLOT[position - 1] * N], partition, sizeof(int) * N) > 0))) {
+    position--;
+  }
+  n_after = archive->size - position;
+  
+  // Insert the new partition at `position`
+  memmove(&archive->DIVERSITY[position + 1], &archive->DIVERSITY[position], sizeof(double) * n_after);
+  memmove(&archive->DISPERSION[position + 1], &archive->DISPERSION[position], sizeof(double) * n_after);
+  memmove(&archive->HASH[position + 1], &archive->HASH[position], sizeof(uint64_t) * n_after);
+  memmove(&archive->SLOT[position + 1], &archive->SLOT[position], sizeof(size_t) * n_after);
+  size_t slot = archive->FREE_SLOTS[--archive->n_free];
+  archive->DIVERSITY[position] = diversity;
+  archive->DISPERSION[position] = dispersion;
+  archive->HASH[position] = hash;
+  archive->SLOT[position] = slot;
+  memcpy(&archive->PARTITIONS[slot * N], partition, sizeof(int) * N);
+  archive->size++;
+  return 0;
+}
+
+// The archive is sorted by diversity, so the dispersion is decreasing across the 
+// archive. Therefore, only the first partition having at least (or more than) 
+// the diversity needs to be checked
+bool paretodominated(struct pareto_archive *archive, double diversity, double dispersion){
+  size_t lower = pareto_lower_bound(archive, diversity);
+  if (lower < archive->size && archive->DISPERSION[lower] > dispersion) {
+    return (true);
+  }
+  size_t upper = pareto_upper_bound(archive, diversity);
+  if (upper < archive->size && archive->DISPERSION[upper] >= dispersion) {
+    return (true);
+  }
   return (false);
 }
 
-// returns 1 if a memory allocation error occurs, 0 otherwise
-int push(struct Pareto_element** head_ref, double diversity, double dispersion, size_t N, int* partition) { 
-  
-        /* 1. allocate node */
-        struct Pareto_element* new_node = (struct Pareto_element*) malloc(sizeof(struct Pareto_element)); 
-        if (new_node == NULL) {
-            return 1;
-        }
-        
-        /* 2. put in the data  */
-        new_node->diversity  = diversity;
-        new_node->dispersion = dispersion;
-        new_node->partition = (int*) malloc(sizeof(int) * N);  // vllt memcpy anstatt schleife?
-        if (new_node->partition == NULL) {
-            free(new_node);
-            return 1;
-        }
-        for(int b = 0;b<N;b++){ 
-            new_node->partition[b]  = partition[b];
-        }
-        
-        /* 3. Make next of new node as head */
-        new_node->next = (*head_ref); 
-            
-        /* 4. move the head to point to the new node */
-        (*head_ref)    = new_node; 
-        return 0;
-}  
+// Index of the first partition with a diversity of at least `diversity` (binary search)
+size_t pareto_lower_bound(struct pareto_archive *archive, double diversity){
+  size_t low = 0;
+  size_t high = archive->size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (archive->DIVERSITY[middle] < diversity) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
 
+// Index of the first partition with a diversity larger than `diversity` (binary search)
+size_t pareto_upper_bound(struct pareto_archive *archive, double diversity){
+  size_t low = 0;
+  size_t high = archive->size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (archive->DIVERSITY[middle] <= diversity) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
 
-void delete_outdated(struct Pareto_element** head_ref, double diversity, double dispersion){
-  
-        struct Pareto_element* temp = *head_ref;
-        struct Pareto_element* prev = *head_ref;
-        struct Pareto_element* safe = NULL;
-        
-        while(temp != NULL && ((diversity >= temp->diversity && dispersion > temp->dispersion) || 
-            (diversity > temp->diversity && dispersion >= temp->dispersion))){
-            *head_ref = temp->next; 
-            prev = temp->next;
-            free(temp->partition);
-            free(temp); 
-            temp = prev;
-        }
-        if(temp != NULL){
-            temp = temp->next;
-        }
-        
-        while(temp != NULL){
-            if((diversity >= temp->diversity && dispersion > temp->dispersion) || 
-                (diversity > temp->diversity && dispersion >= temp->dispersion)){
-            prev->next = temp->next;
-            safe = temp->next;
-            free(temp->partition);
-            free(temp);
-            temp = safe;
-            }else{
-            prev = prev->next;
-            temp = temp->next;
-            }
-        }
-} 
+// Number the clusters by the order of their first element; LABELS is an array of 
+// length N that is used as working memory
+void relabel_partition(size_t N, int* partition, int* relabeled, int* LABELS){
+  for (size_t i = 0; i < N; i++) {
+    LABELS[i] = -1;
+  }
+  int n_labels = 0;
+  for (size_t i = 0; i < N; i++) {
+    if (LABELS[partition[i]] == -1) {
+      LABELS[partition[i]] = n_labels++;
+    }
+    relabeled[i] = LABELS[partition[i]];
+  }
+}
 
+// FNV-1a hash of a partition
+uint64_t hash_partition(size_t N, int* partition){
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < N; i++) {
+    hash ^= (uint64_t) (unsigned int) partition[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
 
 // selects a random partition
-void linked_list_sample(struct Pareto_element* head, size_t N, int* partition){
-  
-  int count = linked_list_length(head);
-  int r = random_integer(0, count-1);
-  struct Pareto_element* current = head; 
-  
-  for (int i = 0; i < r; i++){
-    current = current->next;
+void pareto_sample(struct rng_state *rng, struct pareto_archive *archive, int* partition){
+  int r = random_integer(rng, 0, archive->size - 1);
+  memcpy(partition, &archive->PARTITIONS[archive->SLOT[r] * archive->N], sizeof(int) * archive->N);
+}
+
+
+// Compute the sum of distances between each element and each cluster (N x K table)
+void fill_cluster_sums(size_t N, size_t K, int* partition, double *matrix, double *CLUSTER_SUMS){
+  for (size_t i = 0; i < N * K; i++){
+    CLUSTER_SUMS[i] = 0;
   }
-  
-  for (int i = 0; i < N; i++){
-    partition[i] = current->partition[i];
+  for (size_t i = 0; i < N; i++){
+    for (size_t j = 0; j < N; j++){
+      if (i != j){
+        CLUSTER_SUMS[i * K + partition[j]] += matrix[i * N + j];
+      }
+    }
   }
-  
 }
 
-int linked_list_length(struct Pareto_element* head) {
-  
-  int count = 0;   
-  struct Pareto_element* current = head;  
-  while (current != NULL) 
-  { 
-    count++; 
-    current = current->next; 
-  } 
-  return count; 
-} 
-
-
-double get_diversity_fast(double diversity, int x, int y, size_t N, int* partition, double matrix[N][N], int *frequencies){
-  
-  int cluster_x = partition[x];
-  int cluster_y = partition[y];
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_y && i != x && i != y){
-      diversity -= matrix[i][x] / frequencies[cluster_y];
-    }
+// Diversity of a partition; if features are used, the average diversity based on
+// squared Euclidean distances is computed as the sum of squared distances to the
+// cluster centroids (which is equivalent, because `frequencies` are the cluster sizes)
+double bils_diversity(size_t N, size_t K, int* partition, struct bils_distances *distances, 
+                      int *frequencies){
+  if (distances->features == NULL) {
+    return get_diversity(N, partition, distances->matrix, frequencies);
   }
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_x && i != x){
-      diversity += matrix[i][x] / frequencies[cluster_x];
+  size_t M = distances->M;
+  double SUMS[K * M];
+  fill_centroid_sums(N, K, M, partition, distances->features, SUMS);
+  double sum = 0;
+  for (size_t i = 0; i < N; i++){
+    double *x = &distances->features[i * M];
+    double *centroid_sum = &SUMS[partition[i] * M];
+    for (size_t m = 0; m < M; m++){
+      double difference = x[m] - centroid_sum[m] / frequencies[partition[i]];
+      sum += difference * difference;
     }
   }
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_x && i != x && i != y){
-      diversity -= matrix[i][y] / frequencies[cluster_x];
-    }
+  return(sum);
+}
+
+// Change in diversity when swapping x (in cluster g) and y (in cluster h)
+double bils_diversity_change(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                             struct bils_distances *distances, struct bils_data *data, 
+                             int *frequencies){
+  if (distances->features == NULL) {
+    return diversity_swap_change(x, y, g, h, N, K, distances->matrix, data->CLUSTER_SUMS, frequencies);
   }
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_y && i != y){
-      diversity += matrix[i][y] / frequencies[cluster_y];
+  return centroid_swap_change(x, y, g, h, distances->M, distances->features, data->CLUSTER_SUMS, frequencies);
+}
+
+// Dispersion distance between i and j (squared Euclidean distance if features are used)
+double bils_dispersion_distance(struct bils_distances *distances, size_t i, size_t j){
+  if (distances->features == NULL) {
+    return distances->matrix2[i * distances->N + j];
+  }
+  size_t M = distances->M;
+  double *x = &distances->features[i * M];
+  double *y = &distances->features[j * M];
+  double sum = 0;
+  for (size_t m = 0; m < M; m++){
+    sum += (x[m] - y[m]) * (x[m] - y[m]);
+  }
+  return(sum);
+}
+
+// Sum of the features in each cluster (K x M)
+void fill_centroid_sums(size_t N, size_t K, size_t M, int* partition, double *features, 
+                        double *CENTROID_SUMS){
+  for (size_t i = 0; i < K * M; i++){
+    CENTROID_SUMS[i] = 0;
+  }
+  for (size_t i = 0; i < N; i++){
+    for (size_t m = 0; m < M; m++){
+      CENTROID_SUMS[partition[i] * M + m] += features[i * M + m];
     }
   }
-  
-  return(diversity);  
 }
 
+// Change in the sum of squared distances to the centroids when swapping x (in 
+// cluster g) and y (in cluster h), in O(M). Because the sum of squared norms of the 
+// elements does not change, only the squared norms of the centroid sums matter: 
+// the centroid sum of g changes by d = y - x, the centroid sum of h by -d.
+double centroid_swap_change(size_t x, size_t y, int g, int h, size_t M, double *features, 
+                            double *CENTROID_SUMS, int *frequencies){
+  double *feature_x = &features[x * M];
+  double *feature_y = &features[y * M];
+  double *sum_g = &CENTROID_SUMS[g * M];
+  double *sum_h = &CENTROID_SUMS[h * M];
+  double change_g = 0;
+  double change_h = 0;
+  for (size_t m = 0; m < M; m++){
+    double d = feature_y[m] - feature_x[m];
+    change_g += d * (2 * sum_g[m] + d);
+    change_h += d * (d - 2 * sum_h[m]);
+  }
+  return(-change_g / frequencies[g] - change_h / frequencies[h]);
+}
+
+// Update the centroid sums after x (previously in cluster g) and 
+// y (previously in cluster h) were swapped, in O(M)
+void update_centroid_sums(size_t x, size_t y, int g, int h, size_t M, double *features, 
+                          double *CENTROID_SUMS){
+  for (size_t m = 0; m < M; m++){
+    double d = features[y * M + m] - features[x * M + m];
+    CENTROID_SUMS[g * M + m] += d;
+    CENTROID_SUMS[h * M + m] -= d;
+  }
+}
 
-double get_dispersion_fast(double dispersion, int x,int y, size_t N, int* partition, double matrix[N][N]){
-  
-  int cluster_x = partition[x];
-  int cluster_y = partition[y];
-  bool before = false;
-  bool after = false;
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_y  && i != x && i != y){
-      if(dispersion == matrix[i][x]){
-        before = true;
-        break;
-      }
+// Change in diversity when swapping x (in cluster g) and y (in cluster h), in O(1)
+double diversity_swap_change(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                             double *matrix, double *CLUSTER_SUMS, int *frequencies){
+  double distance = matrix[x * N + y];
+  double change_g = CLUSTER_SUMS[y * K + g] - CLUSTER_SUMS[x * K + g] - distance;
+  double change_h = CLUSTER_SUMS[x * K + h] - CLUSTER_SUMS[y * K + h] - distance;
+  return(change_g / frequencies[g] + change_h / frequencies[h]);
+}
+
+// Update the element-to-cluster sums after x (previously in cluster g) and 
+// y (previously in cluster h) were swapped, in O(N)
+void update_cluster_sums(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                         double *matrix, double *CLUSTER_SUMS){
+  for (size_t i = 0; i < N; i++){
+    double change = matrix[i * N + y] - matrix[i * N + x];
+    if (i == x || i == y){
+      change = i == x ? matrix[x * N + y] : -matrix[x * N + y];
     }
+    CLUSTER_SUMS[i * K + g] += change;
+    CLUSTER_SUMS[i * K + h] -= change;
+  }
+}
+
+// M is the number of features (0 if distance matrices are used); 
+// returns NULL if a memory allocation error occurred
+struct bils_data* allocate_bils_data(size_t N, size_t K, size_t M){
+  struct bils_data *data = (struct bils_data*) malloc(sizeof(struct bils_data));
+  if (data == NULL) {
+    return NULL;
+  }
+  data->n_sums = M > 0 ? K * M : N * K;
+  data->CLUSTER_SUMS = (double*) malloc(sizeof(double) * data->n_sums);
+  data->NN = (struct neighbours*) malloc(sizeof(struct neighbours) * N);
+  data->CLUSTER_DISPERSIONS = (double*) malloc(sizeof(double) * K);
+  data->MEMBERS = (size_t*) malloc(sizeof(size_t) * N);
+  data->POSITIONS = (size_t*) malloc(sizeof(size_t) * N);
+  data->CLUSTER_START = (size_t*) malloc(sizeof(size_t) * (K + 1));
+  if (data->CLUSTER_SUMS == NULL || data->NN == NULL || data->CLUSTER_DISPERSIONS == NULL || 
+      data->MEMBERS == NULL || data->POSITIONS == NULL || data->CLUSTER_START == NULL) {
+    free_bils_data(data);
+    return NULL;
+  }
+  return data;
+}
+
+void copy_bils_data(size_t N, size_t K, struct bils_data *from, struct bils_data *to){
+  memcpy(to->CLUSTER_SUMS, from->CLUSTER_SUMS, sizeof(double) * from->n_sums);
+  memcpy(to->NN, from->NN, sizeof(struct neighbours) * N);
+  memcpy(to->CLUSTER_DISPERSIONS, from->CLUSTER_DISPERSIONS, sizeof(double) * K);
+  memcpy(to->MEMBERS, from->MEMBERS, sizeof(size_t) * N);
+  memcpy(to->POSITIONS, from->POSITIONS, sizeof(size_t) * N);
+  memcpy(to->CLUSTER_START, from->CLUSTER_START, sizeof(size_t) * (K + 1));
+}
+
+void free_bils_data(struct bils_data *data){
+  free(data->CLUSTER_SUMS);
+  free(data->NN);
+  free(data->CLUSTER_DISPERSIONS);
+  free(data->MEMBERS);
+  free(data->POSITIONS);
+  free(data->CLUSTER_START);
+  free(data);
+}
+
+// Set up all data structures for a new partition
+void initialize_bils_data(size_t N, size_t K, int* partition, struct bils_distances *distances, 
+                          struct bils_data *data){
+  if (distances->features == NULL) {
+    fill_cluster_sums(N, K, partition, distances->matrix, data->CLUSTER_SUMS);
+  } else {
+    fill_centroid_sums(N, K, distances->M, partition, distances->features, data->CLUSTER_SUMS);
   }
   
-  for(int i = 0; i < N && (!before); i++){
-    if(partition[i] == cluster_x && i != x && i != y){
-      if(dispersion == matrix[i][y]){
-        before = true;
-        break;
-      }
-    }
+  // Elements ordered by cluster (counting sort)
+  for (size_t c = 0; c <= K; c++){
+    data->CLUSTER_START[c] = 0;
+  }
+  for (size_t i = 0; i < N; i++){
+    data->CLUSTER_START[partition[i] + 1]++;
+  }
+  for (size_t c = 0; c < K; c++){
+    data->CLUSTER_START[c + 1] += data->CLUSTER_START[c];
+  }
+  size_t next[K];
+  for (size_t c = 0; c < K; c++){
+    next[c] = data->CLUSTER_START[c];
+  }
+  for (size_t i = 0; i < N; i++){
+    data->POSITIONS[i] = next[partition[i]]++;
+    data->MEMBERS[data->POSITIONS[i]] = i;
   }
   
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_x && i != x){
-      if(dispersion >= matrix[i][x]){
-        dispersion = matrix[i][x];
-        after = true;
-      }
+  for (size_t i = 0; i < N; i++){
+    bils_update_neighbours(N, i, partition[i], distances, data);
+  }
+  for (size_t c = 0; c < K; c++){
+    data->CLUSTER_DISPERSIONS[c] = bils_cluster_dispersion(c, data);
+  }
+}
+
+// Dispersion after swapping x (in cluster g) and y (in cluster h). Only the 
+// clusters g and h are inspected, using the two nearest neighbours of each element
+double dispersion_swap_value(size_t x, size_t y, int g, int h, size_t K, 
+                             struct bils_distances *distances, struct bils_data *data){
+  double min = INFINITY;
+  for (size_t c = 0; c < K; c++){
+    if ((int) c != g && (int) c != h && data->CLUSTER_DISPERSIONS[c] < min){
+      min = data->CLUSTER_DISPERSIONS[c];
     }
   }
-  
-  for(int i = 0; i < N; i++){
-    if(partition[i] == cluster_y && i != y){
-      if(dispersion >= matrix[i][y]){
-        dispersion = matrix[i][y];
-        after = true;
+  // cluster g loses x and gains y, cluster h loses y and gains x
+  int clusters[2] = {g, h};
+  size_t removed[2] = {x, y};
+  size_t added[2] = {y, x};
+  for (size_t a = 0; a < 2; a++){
+    for (size_t p = data->CLUSTER_START[clusters[a]]; p < data->CLUSTER_START[clusters[a] + 1]; p++){
+      size_t v = data->MEMBERS[p];
+      if (v == removed[a]){
+        continue;
+      }
+      struct neighbours *nn = &data->NN[v];
+      double distance = nn->first == removed[a] ? nn->second_distance : nn->first_distance;
+      double distance_added = bils_dispersion_distance(distances, v, added[a]);
+      if (distance_added < distance){
+        distance = distance_added;
+      }
+      if (distance < min){
+        min = distance;
       }
     }
   }
-  
-  
-  if(!before && !after){
-    return(dispersion);
+  return(min);
+}
+
+// Update all data structures after x (previously in cluster g) and 
+// y (previously in cluster h) were swapped
+void update_bils_data(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                      struct bils_distances *distances, struct bils_data *data){
+  if (distances->features == NULL) {
+    update_cluster_sums(x, y, g, h, N, K, distances->matrix, data->CLUSTER_SUMS);
+  } else {
+    update_centroid_sums(x, y, g, h, distances->M, distances->features, data->CLUSTER_SUMS);
   }
+  size_t position_x = data->POSITIONS[x];
+  data->POSITIONS[x] = data->POSITIONS[y];
+  data->POSITIONS[y] = position_x;
+  data->MEMBERS[data->POSITIONS[x]] = x;
+  data->MEMBERS[data->POSITIONS[y]] = y;
   
-  if(!before && after){
-    return(dispersion);
+  int clusters[2] = {g, h};
+  size_t removed[2] = {x, y};
+  size_t added[2] = {y, x};
+  for (size_t a = 0; a < 2; a++){
+    for (size_t p = data->CLUSTER_START[clusters[a]]; p < data->CLUSTER_START[clusters[a] + 1]; p++){
+      size_t v = data->MEMBERS[p];
+      struct neighbours *nn = &data->NN[v];
+      if (v == added[a] || nn->first == removed[a] || nn->second == removed[a]){
+        bils_update_neighbours(N, v, clusters[a], distances, data);
+      } else {
+        insert_neighbour(nn, added[a], bils_dispersion_distance(distances, v, added[a]));
+      }
+    }
+    data->CLUSTER_DISPERSIONS[clusters[a]] = bils_cluster_dispersion(clusters[a], data);
   }
-  
-  if(before && after){
-    return(dispersion);
+}
+
+// Recompute the two nearest neighbours of element i in its cluster c
+void bils_update_neighbours(size_t N, size_t i, int c, struct bils_distances *distances, 
+                            struct bils_data *data){
+  struct neighbours *nn = &data->NN[i];
+  nn->first = N;
+  nn->second = N;
+  nn->first_distance = INFINITY;
+  nn->second_distance = INFINITY;
+  for (size_t p = data->CLUSTER_START[c]; p < data->CLUSTER_START[c + 1]; p++){
+    size_t v = data->MEMBERS[p];
+    if (v != i){
+      insert_neighbour(nn, v, bils_dispersion_distance(distances, i, v));
+    }
   }
-  
-  if(before && !after){
-    dispersion = get_dispersion(N, partition, matrix);
-    return(dispersion);
+}
+
+// Minimum distance within cluster c, from the nearest neighbours of its elements
+double bils_cluster_dispersion(int c, struct bils_data *data){
+  double min = INFINITY;
+  for (size_t p = data->CLUSTER_START[c]; p < data->CLUSTER_START[c + 1]; p++){
+    if (data->NN[data->MEMBERS[p]].first_distance < min){
+      min = data->NN[data->MEMBERS[p]].first_distance;
+    }
   }
-  
-  return(dispersion);
+  return(min);
 }
 
 // generate a random uniform number in range
-double uni_rnd_number_range(double min, double max) {
-  double number = uniform_rnd_number();
+double uni_rnd_number_range(struct rng_state *rng, double min, double max) {
+  double number = uniform_rnd_number(rng);
   return (min + number * (max - min));
 }
 
 // Generate a random integer in given range
-int random_integer(int min, int max) {
-  int integer = (int) floor(uniform_rnd_number() * (max - min + 1)) + min;
+int random_integer(struct rng_state *rng, int min, int max) {
+  int integer = (int) floor(uniform_rnd_number(rng) * (max - min + 1)) + min;
   return integer;
 }
 
-double uniform_rnd_number(void) {
+// Uniform random number in [0, 1), using the upper 53 bits of the generator
+double uniform_rnd_number(struct rng_state *rng) {
+  return (next_random(rng) >> 11) * 0x1.0p-53;
+}
+
+/* Random number generation uses xoshiro256** (Blackman & Vigna, 2018), which is 
+ * much faster than obtaining each number from R (each call to unif_rand() has to be 
+ * enclosed by GetRNGstate() and PutRNGstate()). The state is seeded once from R's 
+ * RNG, so results are reproducible via set.seed(). Each repetition of BILS uses 
+ * its own generator, seeded from the main generator via seed_rng_from(). */
+
+static inline uint64_t rotate_left(const uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+uint64_t next_random(struct rng_state *rng) {
+  uint64_t *s = rng->s;
+  const uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotate_left(s[3], 45);
+  return result;
+}
+
+// Seed the generator from R's RNG
+void seed_rng(struct rng_state *rng) {
   GetRNGstate();
-  double my_number = unif_rand();
+  uint64_t seed = ((uint64_t) (unif_rand() * 4294967296.0) << 32) | 
+    (uint64_t) (unif_rand() * 4294967296.0);
   PutRNGstate();
-  return my_number;
+  seed_rng_from(rng, seed);
+}
+
+// Seed the generator from a 64 bit number; the four state words are filled via splitmix64
+void seed_rng_from(struct rng_state *rng, uint64_t seed) {
+  for (size_t i = 0; i < 4; i++) {
+    seed += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = seed;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    rng->s[i] = z ^ (z >> 31);
+  }
 }
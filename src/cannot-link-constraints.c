@@ -0,0 +1,43 @@
+
+#include <stdlib.h>
+#include "declarations.h"
+
+/* Cannot-link constraints
+ *
+ * The pairs of elements that must not be assigned to the same cluster are stored
+ * as adjacency list (see `struct cannot_link`), so the memory is linear in the number
+ * of constraints. The exchange methods do not attempt swaps that would violate a
+ * constraint; hence, the initial partition has to satisfy all constraints (this has
+ * to be guaranteed by the caller).
+ */
+
+/* Test if swapping the elements i and j (which are in different clusters) would
+ * assign one of them to a cluster containing one of its cannot-link partners.
+ *
+ * param `size_t i`: Index of first element to be swapped
+ * param `size_t j`: Index of second element to be swapped
+ * param `int *clusters`: The current cluster of each element
+ * param `struct cannot_link *cannot_link`: The cannot-link constraints, or NULL
+ *        if no constraints are used (then, the return value is always 0)
+ *
+ * Returns 1 if the swap violates a constraint, 0 otherwise
+ */
+int cannot_link_violated(size_t i, size_t j, int *clusters, struct cannot_link *cannot_link) {
+        if (cannot_link == NULL) {
+                return 0;
+        }
+        int *PTR = cannot_link->PTR;
+        int *IDX = cannot_link->IDX;
+        // element j itself leaves its cluster, so it is not tested
+        for (int u = PTR[i]; u < PTR[i+1]; u++) {
+                if ((size_t) IDX[u] != j && clusters[IDX[u]] == clusters[j]) {
+                        return 1;
+                }
+        }
+        for (int u = PTR[j]; u < PTR[j+1]; u++) {
+                if ((size_t) IDX[u] != i && clusters[IDX[u]] == clusters[i]) {
+                        return 1;
+                }
+        }
+        return 0;
+}
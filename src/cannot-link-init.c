@@ -0,0 +1,363 @@
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "header.h"
+
+/* Initial partitions for cannot-link anticlustering
+ *
+ * The elements have to be assigned to clusters so that no two cannot-link partners
+ * are in the same cluster, without exceeding the cluster sizes (this is a graph
+ * coloring problem with capacities). The elements having cannot-link partners are
+ * colored using a greedy heuristic (DSATUR): the next element is the uncolored
+ * element having the most different clusters among its partners (its "saturation"),
+ * ties are broken by the number of partners and then at random. It is assigned to the
+ * allowed cluster that has the most free places (which balances the cluster sizes),
+ * ties are broken at random. If an element cannot be assigned to any cluster, the
+ * coloring is restarted (at most `CANNOT_LINK_INIT_ATTEMPTS` times per partition).
+ * The uncolored elements are kept in buckets by their saturation and their number of
+ * partners (see `struct dsatur_queue`), so the next element is found without a pass
+ * through all elements.
+ * The elements without cannot-link partners fill the remaining places at random.
+ *
+ * param *N: The number of elements
+ * param *K: The number of clusters
+ * param *capacities: The size of each cluster, array of length *K (the sum of the
+ *         capacities has to be equal to N - this has to be guaranteed by the caller)
+ * param *CL_PTR: The cannot-link partners of element i are CL_IDX[CL_PTR[i]], ...,
+ *         CL_IDX[CL_PTR[i+1] - 1], array of length *N + 1 (see `struct cannot_link`;
+ *         each pair has to be stored for both elements, without duplicates)
+ * param *CL_IDX: The indices of the cannot-link partners
+ * param *R: The number of initial partitions that are generated
+ * param *result: Array of length *R x *N that receives the partitions (one after
+ *         another), as cluster labels between 0 and (K-1); a partition where the
+ *         elements could not be assigned receives the label -1 for all elements
+ * param *n_failed: Receives the number of partitions that could not be generated
+ * param *mem_error: This is passed with value 0 and only receives the value 1
+ *       if a memory error occurs when executing this function. The caller needs
+ *       to test if this value is 1 after execution.
+ *
+ * Random numbers are generated in C (see `seed_rng()`), so R's RNG is only
+ * called once. A partition is generated in O(C * (K + D) + E) steps, where C is the
+ * number of elements having cannot-link partners, E is the number of cannot-link
+ * pairs and D is the number of different numbers of partners (D < sqrt(2E) + 1). 
+ * The memory is O(C * K + E).
+ */
+
+#define CANNOT_LINK_INIT_ATTEMPTS 10
+
+void cannot_link_init_partitions(int *N, int *K, int *capacities, int *CL_PTR, int *CL_IDX,
+                                 int *R, int *result, int *n_failed, int *mem_error) {
+        const size_t n = (size_t) *N;
+        const size_t k = (size_t) *K;
+
+        // Elements with cannot-link partners are colored, the others fill the clusters
+        size_t c = 0;
+        for (size_t i = 0; i < n; i++) {
+                if (CL_PTR[i+1] > CL_PTR[i]) {
+                        c++;
+                }
+        }
+
+        int *CONSTRAINED = (int*) malloc(sizeof(int) * (c > 0 ? c : 1));
+        int *UNCONSTRAINED = (int*) malloc(sizeof(int) * (n - c > 0 ? n - c : 1));
+        int *COMPACT = (int*) malloc(sizeof(int) * n);
+        int *SATURATION = (int*) malloc(sizeof(int) * (c > 0 ? c : 1));
+        bool *BLOCKED = (bool*) malloc(sizeof(bool) * (c > 0 ? c * k : 1));
+        int *CLUSTER_ORDER = (int*) malloc(sizeof(int) * k);
+        int *FREE = (int*) malloc(sizeof(int) * k);
+        if (CONSTRAINED == NULL || UNCONSTRAINED == NULL || COMPACT == NULL ||
+            SATURATION == NULL || BLOCKED == NULL || CLUSTER_ORDER == NULL || FREE == NULL) {
+                free(CONSTRAINED);
+                free(UNCONSTRAINED);
+                free(COMPACT);
+                free(SATURATION);
+                free(BLOCKED);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                *mem_error = 1;
+                return;
+        }
+
+        size_t n_constrained = 0;
+        size_t n_unconstrained = 0;
+        for (size_t i = 0; i < n; i++) {
+                if (CL_PTR[i+1] > CL_PTR[i]) {
+                        COMPACT[i] = n_constrained;
+                        CONSTRAINED[n_constrained++] = i;
+                } else {
+                        COMPACT[i] = -1;
+                        UNCONSTRAINED[n_unconstrained++] = i;
+                }
+        }
+        struct dsatur_queue *queue = allocate_dsatur_queue(c, k, CONSTRAINED, CL_PTR);
+        if (queue == NULL) {
+                free(CONSTRAINED);
+                free(UNCONSTRAINED);
+                free(COMPACT);
+                free(SATURATION);
+                free(BLOCKED);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                *mem_error = 1;
+                return;
+        }
+
+        struct cannot_link cannot_link = { CL_PTR, CL_IDX };
+        struct rng_state rng;
+        seed_rng(&rng);
+
+        *n_failed = 0;
+        for (size_t r = 0; r < (size_t) *R; r++) {
+                int *partition = result + r * n;
+                bool success = false;
+                for (int attempt = 0; attempt < CANNOT_LINK_INIT_ATTEMPTS && !success; attempt++) {
+                        success = color_cannot_link_graph(
+                                &rng, n, k, c, capacities, &cannot_link, partition, CONSTRAINED,
+                                COMPACT, queue, SATURATION, BLOCKED, CLUSTER_ORDER, FREE
+                        );
+                }
+                if (!success) {
+                        for (size_t i = 0; i < n; i++) {
+                                partition[i] = -1;
+                        }
+                        (*n_failed)++;
+                        continue;
+                }
+                fill_free_places(&rng, k, n_unconstrained, UNCONSTRAINED, partition, FREE);
+        }
+
+        free(CONSTRAINED);
+        free(UNCONSTRAINED);
+        free(COMPACT);
+        free(SATURATION);
+        free(BLOCKED);
+        free(CLUSTER_ORDER);
+        free(FREE);
+        free_dsatur_queue(queue);
+}
+
+// One attempt of coloring the `c` elements in `CONSTRAINED` (see above); afterwards,
+// `FREE` contains the number of free places per cluster. `COMPACT` maps each
+// element to its position in `CONSTRAINED`, which indexes `SATURATION`, the rows
+// of `BLOCKED` (the c x k clusters that are not allowed for an element) and `queue`.
+// Returns true if all elements were assigned
+bool color_cannot_link_graph(struct rng_state *rng, size_t n, size_t k, size_t c,
+                             int *capacities, struct cannot_link *cannot_link,
+                             int *partition, int *CONSTRAINED, int *COMPACT,
+                             struct dsatur_queue *queue, int *SATURATION, bool *BLOCKED,
+                             int *CLUSTER_ORDER, int *FREE) {
+        int *PTR = cannot_link->PTR;
+        int *IDX = cannot_link->IDX;
+
+        for (size_t i = 0; i < n; i++) {
+                partition[i] = -1;
+        }
+        for (size_t u = 0; u < c * k; u++) {
+                BLOCKED[u] = false;
+        }
+        for (size_t u = 0; u < c; u++) {
+                SATURATION[u] = 0;
+        }
+        for (size_t g = 0; g < k; g++) {
+                FREE[g] = capacities[g];
+                CLUSTER_ORDER[g] = g;
+        }
+        reset_dsatur_queue(queue);
+
+        for (size_t remaining = c; remaining > 0; remaining--) {
+                size_t v = dsatur_next(rng, queue);
+                size_t i = CONSTRAINED[v];
+                bool *blocked_i = BLOCKED + v * k;
+
+                shuffle_permutation(rng, k, CLUSTER_ORDER);
+                int cluster = -1;
+                for (size_t g = 0; g < k; g++) {
+                        int h = CLUSTER_ORDER[g];
+                        if (!blocked_i[h] && FREE[h] > 0 && (cluster == -1 || FREE[h] > FREE[cluster])) {
+                                cluster = h;
+                        }
+                }
+                if (cluster == -1) {
+                        return false;
+                }
+                partition[i] = cluster;
+                FREE[cluster]--;
+                dsatur_remove(queue, v, SATURATION[v]);
+                for (int u = PTR[i]; u < PTR[i+1]; u++) {
+                        size_t j = IDX[u];
+                        size_t w = COMPACT[j];
+                        bool *blocked_j = BLOCKED + w * k;
+                        if (partition[j] == -1 && !blocked_j[cluster]) {
+                                blocked_j[cluster] = true;
+                                dsatur_raise(queue, w, SATURATION[w]++);
+                        }
+                }
+        }
+        return true;
+}
+
+// returns NULL if a memory allocation error occurred. `CONSTRAINED` contains the c 
+// elements having neighbours (in the order of the compact indices)
+struct dsatur_queue* allocate_dsatur_queue(size_t c, size_t k, int *CONSTRAINED, int *PTR) {
+        struct dsatur_queue *queue = (struct dsatur_queue*) malloc(sizeof(struct dsatur_queue));
+        if (queue == NULL) {
+                return NULL;
+        }
+        const size_t c_alloc = c > 0 ? c : 1;
+        size_t max_degree = 0;
+        for (size_t v = 0; v < c; v++) {
+                size_t degree = PTR[CONSTRAINED[v] + 1] - PTR[CONSTRAINED[v]];
+                if (degree > max_degree) {
+                        max_degree = degree;
+                }
+        }
+        queue->c = c;
+        queue->k = k;
+        queue->ELEMENTS = (int*) malloc(sizeof(int) * c_alloc);
+        queue->POSITION = (int*) malloc(sizeof(int) * c_alloc);
+        queue->CLASS = (int*) malloc(sizeof(int) * c_alloc);
+        queue->LEVELS = (int*) malloc(sizeof(int) * c_alloc);
+        queue->SEGMENT = (int*) malloc(sizeof(int) * (c_alloc + 1));
+        queue->OFFSET = (size_t*) malloc(sizeof(size_t) * (c_alloc + 1));
+        queue->COUNT = (int*) malloc(sizeof(int) * (k + 1));
+        queue->BOUNDS = NULL;
+        size_t *START = (size_t*) calloc(max_degree + 2, sizeof(size_t));
+        if (queue->ELEMENTS == NULL || queue->POSITION == NULL || queue->CLASS == NULL ||
+            queue->LEVELS == NULL || queue->SEGMENT == NULL || queue->OFFSET == NULL ||
+            queue->COUNT == NULL || START == NULL) {
+                free(START);
+                free_dsatur_queue(queue);
+                return NULL;
+        }
+
+        // Counting sort of the elements by decreasing degree; elements having the
+        // same degree form a class
+        for (size_t v = 0; v < c; v++) {
+                START[PTR[CONSTRAINED[v] + 1] - PTR[CONSTRAINED[v]]]++;
+        }
+        size_t position = 0;
+        queue->n_classes = 0;
+        queue->OFFSET[0] = 0;
+        for (size_t d = max_degree + 1; d > 0; d--) {
+                size_t count = START[d - 1];
+                START[d - 1] = position;
+                if (count > 0) {
+                        size_t q = queue->n_classes++;
+                        size_t levels = d - 1 < k ? d - 1 : k; // the saturation is at most min(degree, k)
+                        queue->SEGMENT[q] = position;
+                        queue->LEVELS[q] = levels;
+                        queue->OFFSET[q + 1] = queue->OFFSET[q] + levels + 2;
+                }
+                position += count;
+        }
+        queue->SEGMENT[queue->n_classes] = c;
+        for (size_t v = 0; v < c; v++) {
+                size_t degree = PTR[CONSTRAINED[v] + 1] - PTR[CONSTRAINED[v]];
+                queue->POSITION[v] = START[degree]++;
+                queue->ELEMENTS[queue->POSITION[v]] = v;
+        }
+        for (size_t q = 0; q < queue->n_classes; q++) {
+                for (int p = queue->SEGMENT[q]; p < queue->SEGMENT[q + 1]; p++) {
+                        queue->CLASS[queue->ELEMENTS[p]] = q;
+                }
+        }
+        free(START);
+
+        queue->BOUNDS = (int*) malloc(sizeof(int) * (queue->OFFSET[queue->n_classes] + 1));
+        if (queue->BOUNDS == NULL) {
+                free_dsatur_queue(queue);
+                return NULL;
+        }
+        return queue;
+}
+
+void free_dsatur_queue(struct dsatur_queue *queue) {
+        free(queue->ELEMENTS);
+        free(queue->POSITION);
+        free(queue->CLASS);
+        free(queue->LEVELS);
+        free(queue->SEGMENT);
+        free(queue->OFFSET);
+        free(queue->COUNT);
+        free(queue->BOUNDS);
+        free(queue);
+}
+
+// All elements are uncolored and have saturation 0
+void reset_dsatur_queue(struct dsatur_queue *queue) {
+        for (size_t q = 0; q < queue->n_classes; q++) {
+                int *bounds = queue->BOUNDS + queue->OFFSET[q];
+                bounds[0] = queue->SEGMENT[q + 1];
+                for (int s = 1; s <= queue->LEVELS[q] + 1; s++) {
+                        bounds[s] = queue->SEGMENT[q];
+                }
+        }
+        for (size_t s = 0; s <= queue->k; s++) {
+                queue->COUNT[s] = 0;
+        }
+        queue->COUNT[0] = queue->c;
+        queue->max_saturation = 0;
+}
+
+// Move element v (compact index) from the block of saturation s to the block of
+// saturation s + 1 in the segment of its class, in O(1) steps
+void dsatur_move_up(struct dsatur_queue *queue, size_t v, int s) {
+        int *bound = queue->BOUNDS + queue->OFFSET[queue->CLASS[v]] + s + 1;
+        int p = queue->POSITION[v];
+        int w = queue->ELEMENTS[*bound];
+        queue->ELEMENTS[p] = w;
+        queue->POSITION[w] = p;
+        queue->ELEMENTS[*bound] = v;
+        queue->POSITION[v] = *bound;
+        (*bound)++;
+}
+
+// The saturation of the uncolored element v increases from s to s + 1
+void dsatur_raise(struct dsatur_queue *queue, size_t v, int s) {
+        dsatur_move_up(queue, v, s);
+        queue->COUNT[s]--;
+        queue->COUNT[s + 1]++;
+        if (s + 1 > queue->max_saturation) {
+                queue->max_saturation = s + 1;
+        }
+}
+
+// Element v having saturation s is colored: it is moved to the colored elements at
+// the start of the segment of its class, in O(k) steps
+void dsatur_remove(struct dsatur_queue *queue, size_t v, int s) {
+        int levels = queue->LEVELS[queue->CLASS[v]];
+        for (int t = s; t <= levels; t++) {
+                dsatur_move_up(queue, v, t);
+        }
+        queue->COUNT[s]--;
+}
+
+// The uncolored element (compact index) having the highest saturation; ties are broken
+// by the degree, and then at random. There has to be an uncolored element
+size_t dsatur_next(struct rng_state *rng, struct dsatur_queue *queue) {
+        while (queue->COUNT[queue->max_saturation] == 0) {
+                queue->max_saturation--;
+        }
+        int s = queue->max_saturation;
+        // the classes are sorted by decreasing degree, and the saturation is at most the degree
+        for (size_t q = 0; q < queue->n_classes && queue->LEVELS[q] >= s; q++) {
+                int *bounds = queue->BOUNDS + queue->OFFSET[q];
+                if (bounds[s + 1] < bounds[s]) {
+                        return queue->ELEMENTS[random_integer(rng, bounds[s + 1], bounds[s] - 1)];
+                }
+        }
+        return queue->ELEMENTS[0]; // not reached
+}
+
+// Assign the `n_elements` elements in `ELEMENTS` to the free places of the clusters
+// (in random order). The number of elements has to be equal to the number of free places
+void fill_free_places(struct rng_state *rng, size_t k, size_t n_elements, int *ELEMENTS,
+                      int *partition, int *FREE) {
+        shuffle_permutation(rng, n_elements, ELEMENTS);
+        size_t u = 0;
+        for (size_t g = 0; g < k; g++) {
+                for (int f = 0; f < FREE[g] && u < n_elements; f++) {
+                        partition[ELEMENTS[u++]] = g;
+                }
+        }
+}
@@ -10,6 +10,26 @@ struct element
         size_t category; // index of element's category
 };
 
+/* Define struct for the two nearest neighbours of an element within its 
+ * cluster (used for dispersion anticlustering); the index n is used if 
+ * there is no neighbour */
+struct neighbours
+{
+        size_t first; // index of the nearest neighbour
+        size_t second; // index of the second nearest neighbour
+        double first_distance;
+        double second_distance;
+};
+
+/* Define struct for cannot-link constraints, stored as adjacency list: the
+ * elements that must not be assigned to the same cluster as element i are 
+ * IDX[PTR[i]], ..., IDX[PTR[i+1]-1] (each pair is stored in both directions) */
+struct cannot_link
+{
+        int *PTR; // array of length N+1
+        int *IDX; // array of length PTR[N]
+};
+
 /* Define struct for nodes in linked list (representing a cluster) */
 struct node
 {
@@ -29,6 +49,9 @@ void kmeans_anticlustering(
         int *C, 
         int *CAT_frequencies,
         int *categories,
+        int *use_cannot_link,
+        int *CL_PTR,
+        int *CL_IDX,
         int *mem_error
 );
 
@@ -36,9 +59,43 @@ void distance_anticlustering_(int n, int k, int c, double *DISTANCES[n], struct
                               size_t *CATEGORY_HEADS[c],
                               int *frequencies, int *clusters, 
                               int *USE_CATS, int *C, int *CAT_frequencies,
-                              int *categories, int *local_maximum, double *OBJ_RESULT, int *mem_error);
+                              int *categories, int *local_maximum, 
+                              int *use_exchange_partners, int *partners, int *k_neighbours,
+                              struct cannot_link *cannot_link,
+                              double *OBJ_RESULT, int *mem_error);
+
+// for dispersion anticlustering based on a nearest neighbour graph
+int knn_critical_change(size_t i, size_t j, double dispersion, int *clusters,
+                        size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                        struct neighbours *NN, double *TMP_DISTANCES, int *TOUCHED);
+void knn_swap(size_t n, size_t i, size_t j, int *clusters, size_t *ADJ_PTR, size_t *ADJ_IDX,
+              double *ADJ_WEIGHTS, struct neighbours *NN, int *TOUCHED);
+void knn_update_neighbours(size_t n, size_t i, int *clusters, size_t *ADJ_PTR, size_t *ADJ_IDX,
+                           double *ADJ_WEIGHTS, struct neighbours *NN);
+double knn_dispersion(size_t n, struct neighbours *NN, size_t *n_critical);
+
+// for sparse distance anticlustering
+double sparse_distance_anticlustering_(size_t n, size_t k, int *clusters, int *frequencies,
+                                       size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                                       double *SUMS_TO_CLUSTERS, double *ROW_I,
+                                       size_t *CAT_PTR, size_t *CAT_IDX,
+                                       int *USE_CATS, int *categories, int *local_maximum,
+                                       int *use_exchange_partners, int *partners, int *k_neighbours);
+int fill_adjacency_list(size_t n, size_t nnz, double *weights, int *row_index, int *col_index,
+                        size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS);
+void fill_category_index(size_t n, size_t c, int *USE_CATS, int *categories, 
+                         size_t *CAT_PTR, size_t *CAT_IDX);
+void update_sums_to_clusters(size_t i, size_t from, size_t to, size_t k,
+                             size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                             double *SUMS_TO_CLUSTERS);
+
+// for must-link anticlustering
+void add_group_distance(size_t g, size_t h, size_t nr, double distance, double *result);
+double centroid_sums_swap_change(size_t i, size_t j, size_t m, double *sums,
+                                 double *sums_g, double *sums_h, int n_g, int n_h);
 
 size_t number_of_categories(int *USE_CATS, int *C);
+int cannot_link_violated(size_t i, size_t j, int *clusters, struct cannot_link *cannot_link);
 int get_cat_frequencies(int *USE_CATS, int *CAT_frequencies, size_t n);
 
 double euclidean_squared(
@@ -128,6 +185,10 @@ double array_sum(
         size_t k, 
         double ARRAY[k]
 );
+double array_min(
+        size_t k, 
+        double ARRAY[k]
+);
 
 int get_indices_by_category(
         size_t n, 
@@ -215,15 +276,108 @@ double minimin_distance_element(
         size_t ID
 );
 
-int has_node_dispersion(
+double dispersion_after_swap(
         size_t n, 
+        size_t k, 
         double *distances[n], 
+        struct node *HEADS[k],
+        struct neighbours NN[n], 
+        double CLUSTER_DISPERSIONS[k],
+        size_t i, 
+        size_t j, 
+        size_t cl1, 
+        size_t cl2, 
+        double threshold
+);
+
+void dispersion_anticlustering_(
+        size_t n, 
+        size_t k, 
+        size_t c, 
+        double *DISTANCES[n], 
+        struct element POINTS[n], 
+        size_t *CATEGORY_HEADS[c], 
+        int *clusters, 
+        int *CAT_frequencies, 
+        int *local_maximum, 
+        double *OBJ_RESULT, 
+        int *mem_error
+);
+
+double dispersion_exchange_pass(
+        size_t n, 
+        size_t k, 
+        size_t c, 
+        double *DISTANCES[n], 
+        struct node *CLUSTER_HEADS[k], 
+        struct node *PTR_NODES[n],
+        size_t *CATEGORY_HEADS[c], 
+        int *CAT_frequencies,
+        struct neighbours NN[n], 
+        double CLUSTER_DISPERSIONS[k]
+);
+
+double targeted_dispersion_search(
+        size_t n, 
+        size_t k, 
+        size_t c, 
+        double *DISTANCES[n], 
+        struct node *CLUSTER_HEADS[k], 
+        struct node *PTR_NODES[n],
+        size_t *CATEGORY_HEADS[c], 
+        int *CAT_frequencies,
+        struct neighbours NN[n], 
+        double CLUSTER_DISPERSIONS[k]
+);
+
+double dispersion_swap(
+        size_t n, 
+        size_t k, 
+        double *DISTANCES[n], 
+        struct node *CLUSTER_HEADS[k], 
+        struct node *PTR_NODES[n], 
+        struct neighbours NN[n], 
+        double CLUSTER_DISPERSIONS[k], 
+        size_t i, 
+        size_t j
+);
+
+double critical_after_swap(
+        size_t n, 
+        size_t k, 
+        double *distances[n], 
+        struct node *HEADS[k],
+        struct neighbours NN[n], 
+        double CLUSTER_DISPERSIONS[k],
+        size_t i, 
+        size_t j, 
+        size_t cl1, 
+        size_t cl2, 
         double dispersion, 
+        int *change
+);
+
+void update_neighbours(
+        size_t n, 
+        double *distances[n], 
+        struct node *HEAD, 
+        size_t ID, 
+        struct neighbours *nn
+);
+
+void insert_neighbour(struct neighbours *nn, size_t ID, double distance);
+
+void update_neighbours_after_swap(
+        size_t n, 
+        double *distances[n], 
         struct node *HEAD, 
-        struct node *node,
-        int after
+        struct neighbours NN[n], 
+        size_t added, 
+        size_t removed
 );
 
+double cluster_dispersion(size_t n, struct node *HEAD, struct neighbours NN[n]);
+
 // Declare Functions
 void fast_kmeans_anticlustering(
         double *data,
@@ -233,7 +387,10 @@ void fast_kmeans_anticlustering(
         int *frequencies,
         int *clusters,
         int *partners,
-        int *k_neighbours
+        int *k_neighbours,
+        int *use_cannot_link,
+        int *CL_PTR,
+        int *CL_IDX
 );
 
 void fast_update_one_center(size_t index_removed_from_cluster, 
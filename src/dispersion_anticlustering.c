@@ -23,6 +23,18 @@
  * param *categories: An assignment of elements to categories,
  *         array of length *N (has to consists of integers between 0 and (C-1) 
  *         - this has to be guaranteed by the caller)
+ * param *local_maximum: A boolean value (i.e., 1/0) indicating whether the 
+ *         targeted search is used, which proceeds until a local maximum is reached
+ *         (only swapping elements that are part of a pair having the minimum 
+ *         distance); otherwise, one pass of the exchange method across all 
+ *         elements is conducted
+ * param *R: The number of repetitions of the optimization (only needed if
+ *         init_partitions are passed)
+ * param *use_init_partitions: A boolean value (i.e., 1/0) indicating whether 
+ *         initial partitions are passed
+ * param *init_partitions: If use_init_partitions is 1: The initial partitions 
+ *         for each of the R repetitions (array of length *R * *N, one partition 
+ *         after the other). The partition having the best dispersion is returned.
  * param *mem_error: This is passed with value 0 and only receives the value 1 
  *       if a memory error occurs when executing this function. The caller needs
  *       to test if this value is 1 after execution.
@@ -32,11 +44,38 @@
 
 void dispersion_anticlustering(double *data, int *N, int *K, int *clusters, 
                               int *USE_CATS, int *C, int *CAT_frequencies,
-                              int *categories, int *mem_error) {
+                              int *categories, int *local_maximum, int *R,
+                              int *use_init_partitions, int *init_partitions, 
+                              int *mem_error) {
         
         const size_t n = (size_t) *N; // number of data points
         const size_t k = (size_t) *K; // number of clusters
         
+        // Restore distance matrix
+        int offsets[n]; // index variable for indexing correct cols in data matrix
+        // Allocate memory for distance matrix in C
+        double *DISTANCES[n];
+        for (size_t i = 0; i < n; i++) {
+                DISTANCES[i] = (double*) malloc(sizeof(double) * n);
+                if (DISTANCES[i] == NULL) {
+                        free_distances(n, DISTANCES, i);
+                        *mem_error = 1;
+                        return;
+                }
+        }
+        
+        // Column offsets (to convert one-dimensional array to Row/Col major)
+        for(size_t i = 0; i < n; i++) {
+                offsets[i] = i * n;
+        }
+        
+        // Reconstruct the data points as N x N distance matrix
+        for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j < n; j++) {
+                        DISTANCES[i][j] = data[offsets[j]++];
+                }
+        }
+        
         // Per data point, store ID, cluster, and category
         struct element POINTS[n]; 
         
@@ -45,6 +84,8 @@ void dispersion_anticlustering(double *data, int *N, int *K, int *clusters,
                 POINTS[i].cluster = clusters[i];
                 POINTS[i].values = malloc(sizeof(double)); // this is just a dummy malloc
                 if (POINTS[i].values == NULL) {
+                        free_points(n, POINTS, i);
+                        free_distances(n, DISTANCES, n);
                         *mem_error = 1;
                         return;
                 }
@@ -57,8 +98,6 @@ void dispersion_anticlustering(double *data, int *N, int *K, int *clusters,
         
         // Some book-keeping variables to track memory error
         int mem_error_categories = 0;
-        int mem_error_cluster_heads = 0;
-        int mem_error_cluster_lists = 0;
         
         // Deal with categorical restrictions
         size_t c = number_of_categories(USE_CATS, C);
@@ -70,67 +109,129 @@ void dispersion_anticlustering(double *data, int *N, int *K, int *clusters,
         );
         if (mem_error_categories == 1) {
                 free_points(n, POINTS, n);
+                free_distances(n, DISTANCES, n);
                 *mem_error = 1;
                 return; 
         }
         
+        // outer optimization loop, across repetitions (where the initial partition varies)
+        double BEST_OBJ = -INFINITY;
+        int BEST_PARTITION[n];
+        size_t partition_counter = 0;
+        double OBJ_RESULT;
+        for (size_t a = 0; a < *R; a++) {
+                if (*use_init_partitions == 1) {
+                        for (size_t i = 0; i < n; i++) {
+                              clusters[i] = init_partitions[partition_counter];
+                              partition_counter++;
+                        }
+                }
+                
+                dispersion_anticlustering_(
+                        n, k, c, DISTANCES, POINTS, CATEGORY_HEADS, clusters, 
+                        CAT_frequencies, local_maximum, &OBJ_RESULT, mem_error
+                );
+                if (*mem_error == 1) {
+                        break;
+                }
+                
+                if (OBJ_RESULT > BEST_OBJ) {
+                        for (size_t i = 0; i < n; i++) {
+                                BEST_PARTITION[i] = clusters[i];
+                        }
+                        BEST_OBJ = OBJ_RESULT;
+                }
+        }
+        
+        // Write output
+        if (*mem_error == 0) {
+                for (size_t i = 0; i < n; i++) {
+                        clusters[i] = BEST_PARTITION[i];
+                }
+        }
+        
+        // in the end, free allocated memory:
+        free_points(n, POINTS, n);
+        free_category_indices(c, CATEGORY_HEADS, c);
+        free_distances(n, DISTANCES, n);
+}
+
+// This function optimizes the dispersion for one initial partition (passed via `clusters`),
+// the optimized partition is written to `clusters` and its dispersion to `OBJ_RESULT`
+void dispersion_anticlustering_(size_t n, size_t k, size_t c, double *DISTANCES[n], 
+                                struct element POINTS[n], size_t *CATEGORY_HEADS[c], 
+                                int *clusters, int *CAT_frequencies, int *local_maximum, 
+                                double *OBJ_RESULT, int *mem_error) {
+        
+        for (size_t i = 0; i < n; i++) {
+                POINTS[i].cluster = clusters[i];
+        }
+        
         /* SET UP CLUSTER STRUCTURE */
         struct node *CLUSTER_HEADS[k];
-        mem_error_cluster_heads = initialize_cluster_heads(k, CLUSTER_HEADS);
-        
+        int mem_error_cluster_heads = initialize_cluster_heads(k, CLUSTER_HEADS);
         if (mem_error_cluster_heads == 1) {
-                free_points(n, POINTS, n);
-                free_category_indices(c, CATEGORY_HEADS, c);
                 *mem_error = 1;
                 return; 
         }
 
         // Set up array of pointers-to-nodes, return if memory runs out
         struct node *PTR_NODES[n];
-        mem_error_cluster_lists = fill_cluster_lists(
+        int mem_error_cluster_lists = fill_cluster_lists(
                 n, k, clusters, 
                 POINTS, PTR_NODES, CLUSTER_HEADS
         );
-        
         if (mem_error_cluster_lists == 1) {
-                free_points(n, POINTS, n);
-                free_category_indices(c, CATEGORY_HEADS, c);
                 free_cluster_list(k, CLUSTER_HEADS, k);
                 *mem_error = 1;
                 return;
         }
         
-        // Restore distance matrix
-        
-        int offsets[n]; // index variable for indexing correct cols in data matrix
-        // Allocate memory for distance matrix in C
-        double *DISTANCES[n];
+        // For each element, store its two nearest neighbours in its cluster; 
+        // for each cluster, store its minimum distance
+        struct neighbours NN[n];
+        double CLUSTER_DISPERSIONS[k];
         for (size_t i = 0; i < n; i++) {
-                DISTANCES[i] = (double*) malloc(sizeof(double) * n);
-                if (DISTANCES[i] == NULL) {
-                        free_distances(n, DISTANCES, i);
-                        free_points(n, POINTS, n);
-                        free_category_indices(c, CATEGORY_HEADS, c);
-                        free_cluster_list(k, CLUSTER_HEADS, k);
-                        *mem_error = 1;
-                        return;
-                }
+                update_neighbours(n, DISTANCES, CLUSTER_HEADS[PTR_NODES[i]->data->cluster], i, &NN[i]);
         }
-        
-        // Column offsets (to convert one-dimensional array to Row/Col major)
-        for(size_t i = 0; i < n; i++) {
-                offsets[i] = i * n;
+        for (size_t i = 0; i < k; i++) {
+                CLUSTER_DISPERSIONS[i] = cluster_dispersion(n, CLUSTER_HEADS[i], NN);
         }
         
-        // Reconstruct the data points as N x N distance matrix
+        // Optimize dispersion: The local maximum search uses the targeted search; 
+        // otherwise, one pass of the exchange method is conducted
+        double OBJECTIVE;
+        if (*local_maximum) {
+                OBJECTIVE = targeted_dispersion_search(
+                        n, k, c, DISTANCES, CLUSTER_HEADS, PTR_NODES, CATEGORY_HEADS, 
+                        CAT_frequencies, NN, CLUSTER_DISPERSIONS
+                );
+        } else {
+                OBJECTIVE = dispersion_exchange_pass(
+                        n, k, c, DISTANCES, CLUSTER_HEADS, PTR_NODES, CATEGORY_HEADS, 
+                        CAT_frequencies, NN, CLUSTER_DISPERSIONS
+                );
+        }
+
+        // Write output
         for (size_t i = 0; i < n; i++) {
-                for (size_t j = 0; j < n; j++) {
-                        DISTANCES[i][j] = data[offsets[j]++];
-                }
+                clusters[i] = PTR_NODES[i]->data->cluster;
         }
+        *OBJ_RESULT = OBJECTIVE;
         
-        // Initialize objective
-        double OBJECTIVE = dispersion_objective(n, k, DISTANCES, CLUSTER_HEADS);
+        free_cluster_list(k, CLUSTER_HEADS, k);
+}
+
+/* One pass of the exchange method for the dispersion: For each element, 
+ * the swap with the exchange partner that maximally improves the dispersion 
+ * is conducted. Returns the dispersion after the pass.
+ */
+double dispersion_exchange_pass(size_t n, size_t k, size_t c, double *DISTANCES[n], 
+                                struct node *CLUSTER_HEADS[k], struct node *PTR_NODES[n],
+                                size_t *CATEGORY_HEADS[c], int *CAT_frequencies,
+                                struct neighbours NN[n], double CLUSTER_DISPERSIONS[k]) {
+        
+        double OBJECTIVE = array_min(k, CLUSTER_DISPERSIONS);
 
         /* Some variables for bookkeeping during the optimization */
         
@@ -143,8 +244,9 @@ void dispersion_anticlustering(double *data, int *N, int *K, int *clusters,
         for (size_t i = 0; i < n; i++) {
                 size_t cl1 = PTR_NODES[i]->data->cluster;
                 
-                // Initialize `best` variable for the i'th item
-                double best_obj = 0;
+                // Initialize `best` variable for the i'th item; only swaps 
+                // that improve the current dispersion are of interest
+                double best_obj = OBJECTIVE;
                 
                 /* 2. Level: Iterate through the exchange partners */
                 size_t category_i = PTR_NODES[i]->data->category;
@@ -160,102 +262,282 @@ void dispersion_anticlustering(double *data, int *N, int *K, int *clusters,
                                 continue;
                         }
                         
-                        // Using local updating of dispersion objective
-                        int i_has_dispersion = has_node_dispersion(
-                                n, DISTANCES, OBJECTIVE, 
-                                CLUSTER_HEADS[PTR_NODES[i]->data->cluster], 
-                                PTR_NODES[i], 0
-                        );
-                        int j_has_dispersion = has_node_dispersion(
-                                n, DISTANCES, OBJECTIVE, 
-                                CLUSTER_HEADS[PTR_NODES[j]->data->cluster], 
-                                PTR_NODES[j], 0
-                        );
-                        
-                        int before = i_has_dispersion || j_has_dispersion;
-                        
-                        // Now swap the elements in the cluster list
-                        swap(n, i, j, PTR_NODES);
+                        // Using local updating of dispersion objective: The swap can only
+                        // improve the dispersion if i or j is part of a pair having the
+                        // minimum distance (i.e., the current dispersion)
+                        if (NN[i].first_distance != OBJECTIVE && NN[j].first_distance != OBJECTIVE) {
+                                continue;
+                        }
                         
-                        i_has_dispersion = has_node_dispersion(
-                                n, DISTANCES, OBJECTIVE, 
-                                CLUSTER_HEADS[PTR_NODES[i]->data->cluster], 
-                                PTR_NODES[i], 1
-                        );
-                        j_has_dispersion = has_node_dispersion(
-                                n, DISTANCES, OBJECTIVE, 
-                                CLUSTER_HEADS[PTR_NODES[j]->data->cluster], 
-                                PTR_NODES[j], 1
+                        tmp_obj = dispersion_after_swap(
+                                n, k, DISTANCES, CLUSTER_HEADS, NN, 
+                                CLUSTER_DISPERSIONS, i, j, cl1, cl2, best_obj
                         );
-                        
-                        int after = i_has_dispersion || j_has_dispersion;
-                        
-                        if (after) {
-                                tmp_obj = best_obj - 1; // cannot improve objective
-                        } else if (!before) {
-                                tmp_obj = best_obj - 1; // cannot improve objective
-                        } else if (before) {
-                                tmp_obj = dispersion_objective(n, k, DISTANCES, CLUSTER_HEADS);
-                                // todo: more speed up
-                        }
 
                         // Update `best` variables if objective was improved
                         if (tmp_obj > best_obj) {
                                 best_obj = tmp_obj;
                                 best_partner = j;
                         }
-                        // Swap back to test next exchange partner
-                        swap(n, i, j, PTR_NODES);
                 }
                 
                 // Only if objective is improved: Do the swap
                 if (best_obj > OBJECTIVE) {
-                        swap(n, i, best_partner, PTR_NODES);
-                        // Update the "global" variables
-                        OBJECTIVE = best_obj;
+                        OBJECTIVE = dispersion_swap(
+                                n, k, DISTANCES, CLUSTER_HEADS, PTR_NODES, 
+                                NN, CLUSTER_DISPERSIONS, i, best_partner
+                        );
                 }
         }
+        return OBJECTIVE;
+}
 
-        // Write output
-        for (size_t i = 0; i < n; i++) {
-                clusters[i] = PTR_NODES[i]->data->cluster;
-        }
+/* Targeted search for the dispersion: Only elements that are part of a pair
+ * having the minimum distance (i.e., a "critical" pair) are swapped, because 
+ * only these swaps can improve the dispersion. A swap is accepted if it 
+ * increases the dispersion, or if it retains the dispersion but reduces the 
+ * number of elements that are part of a critical pair. This is repeated until 
+ * no critical element can be swapped profitably. Returns the dispersion 
+ * after the search.
+ */
+double targeted_dispersion_search(size_t n, size_t k, size_t c, double *DISTANCES[n], 
+                                  struct node *CLUSTER_HEADS[k], struct node *PTR_NODES[n],
+                                  size_t *CATEGORY_HEADS[c], int *CAT_frequencies,
+                                  struct neighbours NN[n], double CLUSTER_DISPERSIONS[k]) {
         
-        // in the end, free allocated memory:
-        free_points(n, POINTS, n);
-        free_category_indices(c, CATEGORY_HEADS, c);
-        free_cluster_list(k, CLUSTER_HEADS, k);
-        free_distances(n, DISTANCES, n);
+        double OBJECTIVE = array_min(k, CLUSTER_DISPERSIONS);
+        int improvement_occured = 1;
+        
+        while (improvement_occured) {
+                improvement_occured = 0;
+                for (size_t i = 0; i < n; i++) {
+                        // only consider elements that are part of a critical pair
+                        if (NN[i].first_distance != OBJECTIVE) {
+                                continue;
+                        }
+                        size_t cl1 = PTR_NODES[i]->data->cluster;
+                        double best_obj = OBJECTIVE;
+                        int best_change = 0; // change in number of critical elements
+                        size_t best_partner = i;
+                        
+                        size_t category_i = PTR_NODES[i]->data->category;
+                        size_t n_partners = CAT_frequencies[category_i];
+                        for (size_t u = 0; u < n_partners; u++) {
+                                size_t j = CATEGORY_HEADS[category_i][u];
+                                size_t cl2 = PTR_NODES[j]->data->cluster;
+                                if (cl1 == cl2) { 
+                                        continue;
+                                }
+                                int change;
+                                double tmp_obj = critical_after_swap(
+                                        n, k, DISTANCES, CLUSTER_HEADS, NN, CLUSTER_DISPERSIONS,
+                                        i, j, cl1, cl2, OBJECTIVE, &change
+                                );
+                                // lexicographic comparison: (1) dispersion, (2) number of critical elements
+                                if (tmp_obj > best_obj || 
+                                    (tmp_obj == OBJECTIVE && best_obj == OBJECTIVE && change < best_change)) {
+                                        best_obj = tmp_obj;
+                                        best_change = change;
+                                        best_partner = j;
+                                }
+                        }
+                        
+                        if (best_partner != i) {
+                                OBJECTIVE = dispersion_swap(
+                                        n, k, DISTANCES, CLUSTER_HEADS, PTR_NODES, 
+                                        NN, CLUSTER_DISPERSIONS, i, best_partner
+                                );
+                                improvement_occured = 1;
+                        }
+                }
+        }
+        return OBJECTIVE;
+}
+
+/* Swap elements i and j and update the nearest neighbours and the minimum
+ * distances of the two clusters that are involved. Returns the new dispersion.
+ */
+double dispersion_swap(size_t n, size_t k, double *DISTANCES[n], struct node *CLUSTER_HEADS[k], 
+                       struct node *PTR_NODES[n], struct neighbours NN[n], 
+                       double CLUSTER_DISPERSIONS[k], size_t i, size_t j) {
+        size_t cl1 = PTR_NODES[i]->data->cluster;
+        size_t cl2 = PTR_NODES[j]->data->cluster;
+        swap(n, i, j, PTR_NODES);
+        update_neighbours_after_swap(n, DISTANCES, CLUSTER_HEADS[cl1], NN, j, i);
+        update_neighbours_after_swap(n, DISTANCES, CLUSTER_HEADS[cl2], NN, i, j);
+        CLUSTER_DISPERSIONS[cl1] = cluster_dispersion(n, CLUSTER_HEADS[cl1], NN);
+        CLUSTER_DISPERSIONS[cl2] = cluster_dispersion(n, CLUSTER_HEADS[cl2], NN);
+        return array_min(k, CLUSTER_DISPERSIONS);
 }
 
-// Check if an element has a connection to another element in the same cluster, where 
-// their pairwise distance is the current dispersion. For implementing Martin B.'s clever speed ups.
-// Has parameter `after` to check if the minimum within-cluster distance is lower after 
-// a swap.
-int has_node_dispersion(size_t n, double *distances[n], double dispersion, struct node *HEAD, struct node *node, int after) {
+/* For the targeted search: Compute the dispersion that results from swapping 
+ * elements i and j (which are in the clusters cl1 and cl2), without actually 
+ * swapping them. If the dispersion remains the same, `change` receives the 
+ * change in the number of elements that are part of a critical pair (i.e., 
+ * having a nearest neighbour at distance `dispersion`). Computation stops 
+ * early if the dispersion decreases.
+ */
+double critical_after_swap(size_t n, size_t k, double *distances[n], struct node *HEADS[k],
+                           struct neighbours NN[n], double CLUSTER_DISPERSIONS[k],
+                           size_t i, size_t j, size_t cl1, size_t cl2, 
+                           double dispersion, int *change) {
+        double min = INFINITY;
+        for (size_t c = 0; c < k; c++) {
+                if (c != cl1 && c != cl2 && CLUSTER_DISPERSIONS[c] < min) {
+                        min = CLUSTER_DISPERSIONS[c];
+                }
+        }
+        *change = 0;
+        size_t clusters[2] = {cl1, cl2};
+        size_t removed[2] = {i, j};
+        size_t added[2] = {j, i};
+        for (size_t a = 0; a < 2; a++) {
+                double distance_added = INFINITY; // nearest neighbour of the added element
+                struct node *current = HEADS[clusters[a]]->next;
+                while (current != NULL) {
+                        size_t v = current->data->ID;
+                        current = current->next;
+                        if (NN[v].first_distance == dispersion) {
+                                (*change)--;
+                        }
+                        if (v == removed[a]) {
+                                continue;
+                        }
+                        double distance = NN[v].first == removed[a] ? 
+                                NN[v].second_distance : NN[v].first_distance;
+                        double tmp_distance = distances[v][added[a]];
+                        if (tmp_distance < distance) {
+                                distance = tmp_distance;
+                        }
+                        if (tmp_distance < distance_added) {
+                                distance_added = tmp_distance;
+                        }
+                        if (distance < dispersion) {
+                                return distance;
+                        }
+                        if (distance == dispersion) {
+                                (*change)++;
+                        }
+                        if (distance < min) {
+                                min = distance;
+                        }
+                }
+                if (distance_added == dispersion) {
+                        (*change)++;
+                }
+        }
+        return min;
+}
+
+/* Compute the dispersion that results from swapping elements i and j
+ * (which are in the clusters cl1 and cl2), without actually swapping them. 
+ * Only the minimum distances in the clusters cl1 and cl2 change, which are 
+ * obtained from the nearest neighbours of their members. Computation stops 
+ * early when the dispersion cannot exceed `threshold`; in this case, some value
+ * <= `threshold` is returned.
+ */
+double dispersion_after_swap(size_t n, size_t k, double *distances[n], struct node *HEADS[k],
+                             struct neighbours NN[n], double CLUSTER_DISPERSIONS[k],
+                             size_t i, size_t j, size_t cl1, size_t cl2, double threshold) {
+        double min = INFINITY;
+        for (size_t c = 0; c < k; c++) {
+                if (c != cl1 && c != cl2 && CLUSTER_DISPERSIONS[c] < min) {
+                        min = CLUSTER_DISPERSIONS[c];
+                }
+        }
+        if (min <= threshold) {
+                return min;
+        }
+        // cluster 1 loses i and gains j, cluster 2 loses j and gains i
+        size_t clusters[2] = {cl1, cl2};
+        size_t removed[2] = {i, j};
+        size_t added[2] = {j, i};
+        for (size_t a = 0; a < 2; a++) {
+                struct node *current = HEADS[clusters[a]]->next;
+                while (current != NULL) {
+                        size_t v = current->data->ID;
+                        current = current->next;
+                        if (v == removed[a]) {
+                                continue;
+                        }
+                        // nearest neighbour of v in the cluster without the removed element
+                        double distance = NN[v].first == removed[a] ? 
+                                NN[v].second_distance : NN[v].first_distance;
+                        if (distances[v][added[a]] < distance) {
+                                distance = distances[v][added[a]];
+                        }
+                        if (distance < min) {
+                                min = distance;
+                                if (min <= threshold) {
+                                        return min;
+                                }
+                        }
+                }
+        }
+        return min;
+}
+
+// Recompute the two nearest neighbours of element `ID` in its cluster 
+// (the cluster list starting at `HEAD`)
+void update_neighbours(size_t n, double *distances[n], struct node *HEAD, 
+                       size_t ID, struct neighbours *nn) {
+        nn->first = n;
+        nn->second = n;
+        nn->first_distance = INFINITY;
+        nn->second_distance = INFINITY;
         struct node *current = HEAD->next;
-        int id_node = node->data->ID;
         while (current != NULL) {
-                int tmp_id = current->data->ID;
+                size_t tmp_id = current->data->ID;
                 current = current->next;
-                if (tmp_id == id_node) {
-                        continue; 
+                if (tmp_id != ID) {
+                        insert_neighbour(nn, tmp_id, distances[ID][tmp_id]);
                 }
-                double current_distance = distances[id_node][tmp_id];
-                if (after) {
-                        if (current_distance <= dispersion) {
-                                return 1;
-                        }
+        }
+}
+
+// Insert a new element into the two nearest neighbours of an element (if it is nearer)
+void insert_neighbour(struct neighbours *nn, size_t ID, double distance) {
+        if (distance < nn->first_distance) {
+                nn->second = nn->first;
+                nn->second_distance = nn->first_distance;
+                nn->first = ID;
+                nn->first_distance = distance;
+        } else if (distance < nn->second_distance) {
+                nn->second = ID;
+                nn->second_distance = distance;
+        }
+}
+
+// After a swap, update the nearest neighbours of all members of a cluster 
+// (the cluster list starting at `HEAD`), where element `added` has replaced 
+// element `removed`. Only the members having `removed` among their nearest 
+// neighbours need to be recomputed.
+void update_neighbours_after_swap(size_t n, double *distances[n], struct node *HEAD, 
+                                  struct neighbours NN[n], size_t added, size_t removed) {
+        struct node *current = HEAD->next;
+        while (current != NULL) {
+                size_t v = current->data->ID;
+                current = current->next;
+                if (v == added || NN[v].first == removed || NN[v].second == removed) {
+                        update_neighbours(n, distances, HEAD, v, &NN[v]);
                 } else {
-                        if (current_distance == dispersion) {
-                                return 1;
-                        }
+                        insert_neighbour(&NN[v], added, distances[v][added]);
                 }
-                
         }
-        return 0;
 }
 
+// Minimum distance within a cluster, obtained from the nearest neighbours of its members
+double cluster_dispersion(size_t n, struct node *HEAD, struct neighbours NN[n]) {
+        double min = INFINITY;
+        struct node *current = HEAD->next;
+        while (current != NULL) {
+                if (NN[current->data->ID].first_distance < min) {
+                        min = NN[current->data->ID].first_distance;
+                }
+                current = current->next;
+        }
+        return min;
+}
 
 // Compute sum of distances by cluster
 double dispersion_objective(size_t n, size_t k, double *distances[n], 
@@ -28,6 +28,26 @@
  *         - this has to be guaranteed by the caller)
  * param *local_maximum: Use local maximum search instead of default exchange method
  *       that terminates after one iteration through the data set
+ * param *R: The number of repetitions (i.e., restarts from different initial partitions)
+ * param *use_init_partitions: A boolean value (i.e., 1/0) indicating whether the 
+ *       initial partitions for the *R repetitions are passed via `init_partitions`
+ * param *init_partitions: Array of length *N x *R, the initial partitions
+ * param *use_exchange_partners: A boolean value (i.e., 1/0) indicating whether 
+ *       the exchange partners are restricted via the argument `partners`
+ * param *partners: A pointer array of length N * k_neighbours, indicating for each 
+ *        element which other elements are exchange partners. The first `k_neighbours`
+ *        entries are the exchange partners of element 1, the next belong to element
+ *        2, and so forth. If an entry is N, it is skipped (only indices up to N-1 work, 
+ *        so N is used to indicate that no exchange partners follow). If categorical 
+ *        constraints are used, only partners having the same category are considered.
+ * param *k_neighbours: The number of exchange partners per element.
+ * param *use_cannot_link: A boolean value (i.e., 1/0) indicating whether 
+ *       cannot-link constraints are passed via `CL_PTR` and `CL_IDX`
+ * param *CL_PTR: Array of length N+1, the cannot-link partners of element i are 
+ *       stored in CL_IDX[CL_PTR[i]], ..., CL_IDX[CL_PTR[i+1]-1]. Swaps that would
+ *       assign an element to the same cluster as one of its cannot-link partners 
+ *       are not conducted; the initial partition(s) must satisfy the constraints.
+ * param *CL_IDX: Array of the (0-indexed) cannot-link partners.
  * param *mem_error: This is passed with value 0 and only receives the value 1 
  *       if a memory error occurs when executing this function. The caller needs
  *       to test if this value is 1 after execution.
@@ -38,7 +58,10 @@
 void distance_anticlustering(double *data, int *N, int *K, int *frequencies, int *clusters, 
                               int *USE_CATS, int *C, int *CAT_frequencies,
                               int *categories, int *local_maximum, int* R,
-                              int *use_init_partitions, int *init_partitions, int *mem_error) {
+                              int *use_init_partitions, int *init_partitions, 
+                              int *use_exchange_partners, int *partners, int *k_neighbours,
+                              int *use_cannot_link, int *CL_PTR, int *CL_IDX,
+                              int *mem_error) {
         
         const size_t n = (size_t) *N; // number of data points
         const size_t k = (size_t) *K; // number of clusters
@@ -103,6 +126,9 @@ void distance_anticlustering(double *data, int *N, int *K, int *frequencies, int
                 return; 
         }
         
+        struct cannot_link constraints = { .PTR = CL_PTR, .IDX = CL_IDX };
+        struct cannot_link *cannot_link = *use_cannot_link ? &constraints : NULL;
+        
         // outer optimization loop, across repetitions (where the initial partition varies)
         double BEST_OBJ = 0;
         int BEST_PARTITION[n];
@@ -118,7 +144,9 @@ void distance_anticlustering(double *data, int *N, int *K, int *frequencies, int
                 
                 distance_anticlustering_(
                         n, k, c, DISTANCES, POINTS, CATEGORY_HEADS, frequencies, clusters, USE_CATS,
-                        C, CAT_frequencies, categories, local_maximum, OBJ_RESULT, mem_error
+                        C, CAT_frequencies, categories, local_maximum, 
+                        use_exchange_partners, partners, k_neighbours, cannot_link, 
+                        OBJ_RESULT, mem_error
                 );
 
                 if (*OBJ_RESULT > BEST_OBJ) {
@@ -145,7 +173,10 @@ void distance_anticlustering_(int n, int k, int c, double *DISTANCES[n], struct
                               size_t *CATEGORY_HEADS[c],
                               int *frequencies, int *clusters, 
                               int *USE_CATS, int *C, int *CAT_frequencies,
-                              int *categories, int *local_maximum, double *OBJ_RESULT, int *mem_error) {
+                              int *categories, int *local_maximum, 
+                              int *use_exchange_partners, int *partners, int *k_neighbours,
+                              struct cannot_link *cannot_link,
+                              double *OBJ_RESULT, int *mem_error) {
         
         for (size_t i = 0; i < n; i++) {
                 POINTS[i].cluster = clusters[i];
@@ -207,14 +238,34 @@ void distance_anticlustering_(int n, int k, int c, double *DISTANCES[n], struct
                         // `category_i = 0` if `USE_CATS == FALSE`.
                         size_t n_partners = CAT_frequencies[category_i];
                         // `CAT_frequencies[0] == n` if `USE_CATS == FALSE`
+                        if (*use_exchange_partners) {
+                                n_partners = (size_t) *k_neighbours;
+                        }
                         for (size_t u = 0; u < n_partners; u++) {
                                 // recode exchange partner index
-                                size_t j = CATEGORY_HEADS[category_i][u];
+                                size_t j;
+                                if (*use_exchange_partners) {
+                                        j = partners[i * n_partners + u];
+                                        if (j == n) { // no exchange partners any more
+                                                continue;
+                                        }
+                                        // partners must also respect categorical constraints
+                                        if (POINTS[j].category != category_i) {
+                                                continue;
+                                        }
+                                } else {
+                                        j = CATEGORY_HEADS[category_i][u];
+                                }
                                 size_t cl2 = PTR_NODES[j]->data->cluster;
                                 // no swapping attempt if in the same cluster:
                                 if (cl1 == cl2) { 
                                         continue;
                                 }
+                                // no swapping attempt if it violates a cannot-link constraint
+                                // (`clusters` is kept up to date for this purpose):
+                                if (cannot_link_violated(i, j, clusters, cannot_link)) {
+                                        continue;
+                                }
                                 
                                 // Initialize `tmp` variable for the exchange partner:
                                 copy_array(k, OBJ_BY_CLUSTER, tmp_objs);
@@ -268,6 +319,7 @@ void distance_anticlustering_(int n, int k, int c, double *DISTANCES[n], struct
                                         improvement_occured = 1;
                                 }
                                 swap(n, i, best_partner, PTR_NODES);
+                                fast_swap(clusters, i, best_partner);
                                 // Update the "global" variables
                                 SUM_OBJECTIVE = best_obj;
                                 copy_array(k, best_objs, OBJ_BY_CLUSTER);
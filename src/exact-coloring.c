@@ -0,0 +1,319 @@
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "header.h"
+
+/* Exact graph coloring with cluster sizes (used in `optimal_dispersion()`)
+ *
+ * Test whether the elements can be assigned to K clusters so that no two adjacent
+ * elements are in the same cluster, without exceeding the cluster sizes. This is
+ * the feasibility problem that is otherwise solved via the K-coloring ILP.
+ *
+ * 1. The greedy coloring heuristic (`color_cannot_link_graph()`) is tried first.
+ * 2. If the greedy clique in the graph has more than K elements, the graph
+ *    cannot be colored.
+ * 3. Otherwise, a branch and bound search assigns the elements in DSATUR order
+ *    (the uncolored element having the most different clusters among its colored
+ *    neighbours, ties are broken by the number of neighbours) to all allowed
+ *    clusters. A branch is pruned as soon as an uncolored element has no allowed
+ *    cluster left. Empty clusters having the same size are interchangeable, so only
+ *    the first of them is tried.
+ *
+ * Only elements having neighbours are colored, the other elements can fill the
+ * remaining places of the clusters in any way.
+ *
+ * param *N: The number of elements
+ * param *K: The number of clusters
+ * param *capacities: The size of each cluster, array of length *K (the sum of the
+ *         capacities has to be equal to N - this has to be guaranteed by the caller)
+ * param *CL_PTR: The neighbours of element i are CL_IDX[CL_PTR[i]], ...,
+ *         CL_IDX[CL_PTR[i+1] - 1], array of length *N + 1 (see `struct cannot_link`;
+ *         each edge has to be stored for both elements, without duplicates)
+ * param *CL_IDX: The indices of the neighbours
+ * param *time_limit: The time limit in seconds for the branch and bound search
+ *         (a value <= 0 means no time limit)
+ * param *coloring: Array of length *N that receives the cluster of each element
+ *         (between 0 and (K-1)) if the graph can be colored; elements without
+ *         neighbours receive the label -1
+ * param *status: Receives `COLORING_FOUND` (1) if the graph was colored,
+ *         `COLORING_NONE` (0) if it cannot be colored, `COLORING_STOPPED` (2) if the
+ *         time limit was exceeded and `COLORING_INTERRUPTED` (3) if the user interrupted
+ * param *mem_error: This is passed with value 0 and only receives the value 1
+ *       if a memory error occurs when executing this function. The caller needs
+ *       to test if this value is 1 after execution.
+ *
+ * The memory is O(C * K + E), where C is the number of elements having neighbours
+ * and E is the number of edges.
+ */
+
+#define EXACT_COLORING_GREEDY_ATTEMPTS 10
+
+void exact_coloring(int *N, int *K, int *capacities, int *CL_PTR, int *CL_IDX,
+                    double *time_limit, int *coloring, int *status, int *mem_error) {
+        const size_t n = (size_t) *N;
+        const size_t k = (size_t) *K;
+
+        size_t c = 0;
+        for (size_t i = 0; i < n; i++) {
+                if (CL_PTR[i+1] > CL_PTR[i]) {
+                        c++;
+                }
+        }
+        const size_t c_alloc = c > 0 ? c : 1;
+
+        int *NODES = (int*) malloc(sizeof(int) * c_alloc);
+        int *COMPACT = (int*) malloc(sizeof(int) * n);
+        int *SATURATION = (int*) malloc(sizeof(int) * c_alloc);
+        bool *BLOCKED = (bool*) malloc(sizeof(bool) * c_alloc * k);
+        int *COUNTS = (int*) malloc(sizeof(int) * c_alloc * k);
+        int *COLOR = (int*) malloc(sizeof(int) * c_alloc);
+        int *MARK = (int*) calloc(c_alloc, sizeof(int));
+        int *CLUSTER_ORDER = (int*) malloc(sizeof(int) * k);
+        int *FREE = (int*) malloc(sizeof(int) * k);
+        int *USED = (int*) malloc(sizeof(int) * k);
+        if (NODES == NULL || COMPACT == NULL || SATURATION == NULL ||
+            BLOCKED == NULL || COUNTS == NULL || COLOR == NULL || MARK == NULL ||
+            CLUSTER_ORDER == NULL || FREE == NULL || USED == NULL) {
+                free(NODES);
+                free(COMPACT);
+                free(SATURATION);
+                free(BLOCKED);
+                free(COUNTS);
+                free(COLOR);
+                free(MARK);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                free(USED);
+                *mem_error = 1;
+                return;
+        }
+
+        size_t v = 0;
+        for (size_t i = 0; i < n; i++) {
+                if (CL_PTR[i+1] > CL_PTR[i]) {
+                        COMPACT[i] = v;
+                        NODES[v++] = i;
+                } else {
+                        COMPACT[i] = -1;
+                }
+        }
+        struct cannot_link graph = { CL_PTR, CL_IDX };
+
+        // 1. Greedy heuristic
+        struct dsatur_queue *queue = allocate_dsatur_queue(c, k, NODES, CL_PTR);
+        if (queue == NULL) {
+                free(NODES);
+                free(COMPACT);
+                free(SATURATION);
+                free(BLOCKED);
+                free(COUNTS);
+                free(COLOR);
+                free(MARK);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                free(USED);
+                *mem_error = 1;
+                return;
+        }
+        struct rng_state rng;
+        seed_rng(&rng);
+        *status = COLORING_NONE;
+        for (int attempt = 0; attempt < EXACT_COLORING_GREEDY_ATTEMPTS; attempt++) {
+                if (color_cannot_link_graph(&rng, n, k, c, capacities, &graph, coloring,
+                                            NODES, COMPACT, queue, SATURATION, BLOCKED,
+                                            CLUSTER_ORDER, FREE)) {
+                        *status = COLORING_FOUND;
+                        break;
+                }
+        }
+        free_dsatur_queue(queue);
+
+        struct coloring_search search = {
+                .c = c, .k = k, .NODES = NODES, .COMPACT = COMPACT, .PTR = CL_PTR,
+                .IDX = CL_IDX, .CAPACITIES = capacities, .COLOR = COLOR, .COUNTS = COUNTS,
+                .SATURATION = SATURATION, .FREE = FREE, .USED = USED,
+                .start = bils_wall_time(), .time_limit = *time_limit, .visited = 0,
+                .next_interrupt_check = COLORING_INTERRUPT_INTERVAL, .stop = COLORING_NONE
+        };
+
+        // 2. Lower bound: clique size
+        if (*status != COLORING_FOUND && greedy_clique_size(&search, MARK) <= k) {
+                // 3. Branch and bound
+                for (size_t u = 0; u < c; u++) {
+                        COLOR[u] = -1;
+                        SATURATION[u] = 0;
+                }
+                for (size_t u = 0; u < c * k; u++) {
+                        COUNTS[u] = 0;
+                }
+                for (size_t h = 0; h < k; h++) {
+                        FREE[h] = capacities[h];
+                        USED[h] = 0;
+                }
+                *status = coloring_branch(&search, 0);
+                for (size_t i = 0; i < n; i++) {
+                        coloring[i] = -1;
+                }
+                if (*status == COLORING_FOUND) {
+                        for (size_t u = 0; u < c; u++) {
+                                coloring[NODES[u]] = COLOR[u];
+                        }
+                }
+        }
+
+        free(NODES);
+        free(COMPACT);
+        free(SATURATION);
+        free(BLOCKED);
+        free(COUNTS);
+        free(COLOR);
+        free(MARK);
+        free(CLUSTER_ORDER);
+        free(FREE);
+        free(USED);
+}
+
+// Color the remaining elements recursively, `n_colored` elements are already
+// colored. Returns `COLORING_FOUND` if all elements were colored (then, the coloring
+// is stored in `search->COLOR`), `COLORING_NONE` if the current partial coloring
+// cannot be completed, or `COLORING_STOPPED` / `COLORING_INTERRUPTED`
+int coloring_branch(struct coloring_search *search, size_t n_colored) {
+        const size_t c = search->c;
+        const size_t k = search->k;
+        if (n_colored == c) {
+                return COLORING_FOUND;
+        }
+        if (coloring_stopped(search)) {
+                return search->stop;
+        }
+
+        // DSATUR: select the next element, and prune if an element cannot be colored
+        size_t v = c;
+        for (size_t u = 0; u < c; u++) {
+                if (search->COLOR[u] != -1) {
+                        continue;
+                }
+                int *counts_u = search->COUNTS + u * k;
+                bool allowed = false;
+                for (size_t h = 0; h < k && !allowed; h++) {
+                        allowed = counts_u[h] == 0 && search->FREE[h] > 0;
+                }
+                if (!allowed) {
+                        return COLORING_NONE;
+                }
+                if (v == c || search->SATURATION[u] > search->SATURATION[v] ||
+                    (search->SATURATION[u] == search->SATURATION[v] &&
+                     coloring_degree(search, u) > coloring_degree(search, v))) {
+                        v = u;
+                }
+        }
+
+        int *counts_v = search->COUNTS + v * k;
+        for (size_t h = 0; h < k; h++) {
+                if (counts_v[h] > 0 || search->FREE[h] == 0 || symmetric_empty_cluster(search, h)) {
+                        continue;
+                }
+                set_coloring(search, v, h, 1);
+                int result = coloring_branch(search, n_colored + 1);
+                if (result != COLORING_NONE) {
+                        return result;
+                }
+                set_coloring(search, v, h, -1);
+        }
+        return COLORING_NONE;
+}
+
+// Assign the element v (compact index) to cluster h (`change` = 1) or remove it
+// from cluster h (`change` = -1), and update the saturation of its neighbours
+void set_coloring(struct coloring_search *search, size_t v, size_t h, int change) {
+        const size_t k = search->k;
+        search->COLOR[v] = change == 1 ? (int) h : -1;
+        search->FREE[h] -= change;
+        search->USED[h] += change;
+        size_t i = search->NODES[v];
+        for (int u = search->PTR[i]; u < search->PTR[i+1]; u++) {
+                size_t j = search->COMPACT[search->IDX[u]];
+                int *count = search->COUNTS + j * k + h;
+                if (change == 1 && (*count)++ == 0) {
+                        search->SATURATION[j]++;
+                } else if (change == -1 && --(*count) == 0) {
+                        search->SATURATION[j]--;
+                }
+        }
+}
+
+// Is cluster h empty, and is there a cluster before h that is empty as well and has
+// the same size? (Then, assigning an element to h is equivalent to assigning it to
+// this cluster, which has already been tried.)
+bool symmetric_empty_cluster(struct coloring_search *search, size_t h) {
+        if (search->USED[h] > 0) {
+                return false;
+        }
+        for (size_t g = 0; g < h; g++) {
+                if (search->USED[g] == 0 && search->CAPACITIES[g] == search->CAPACITIES[h]) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+// Number of neighbours of element v (compact index)
+int coloring_degree(struct coloring_search *search, size_t v) {
+        size_t i = search->NODES[v];
+        return search->PTR[i+1] - search->PTR[i];
+}
+
+// Size of the largest clique that is found by greedily extending each element with
+// its neighbours (the search stops as soon as a clique has more than K elements).
+// `MARK` counts for each element the number of clique members it is adjacent to;
+// it has to be initialized with 0 and is 0 again after the function returns
+size_t greedy_clique_size(struct coloring_search *search, int *MARK) {
+        int *PTR = search->PTR;
+        int *IDX = search->IDX;
+        size_t max_size = 0;
+        size_t CLIQUE[search->k + 1];
+        for (size_t v = 0; v < search->c && max_size <= search->k; v++) {
+                size_t i = search->NODES[v];
+                size_t size = 0;
+                CLIQUE[size++] = i;
+                mark_neighbours(search, i, MARK, 1);
+                for (int u = PTR[i]; u < PTR[i+1] && size <= search->k; u++) {
+                        size_t j = IDX[u];
+                        if ((size_t) MARK[search->COMPACT[j]] == size) {
+                                CLIQUE[size++] = j;
+                                mark_neighbours(search, j, MARK, 1);
+                        }
+                }
+                for (size_t u = 0; u < size; u++) {
+                        mark_neighbours(search, CLIQUE[u], MARK, -1);
+                }
+                if (size > max_size) {
+                        max_size = size;
+                }
+        }
+        return max_size;
+}
+
+// Add `change` to the `MARK` of all neighbours of element i
+void mark_neighbours(struct coloring_search *search, size_t i, int *MARK, int change) {
+        for (int u = search->PTR[i]; u < search->PTR[i+1]; u++) {
+                MARK[search->COMPACT[search->IDX[u]]] += change;
+        }
+}
+
+// Check whether the search has to stop because the time limit is exceeded or the
+// user interrupted (only checked every `COLORING_INTERRUPT_INTERVAL` nodes of the
+// search tree)
+bool coloring_stopped(struct coloring_search *search) {
+        search->visited++;
+        if (search->visited < search->next_interrupt_check) {
+                return false;
+        }
+        search->next_interrupt_check = search->visited + COLORING_INTERRUPT_INTERVAL;
+        if (search->time_limit > 0 && bils_wall_time() - search->start >= search->time_limit) {
+                search->stop = COLORING_STOPPED;
+        } else if (bils_interrupt_pending()) {
+                search->stop = COLORING_INTERRUPTED;
+        }
+        return search->stop != COLORING_NONE;
+}
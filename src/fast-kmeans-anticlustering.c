@@ -23,6 +23,13 @@
  *        2, and so forth. If an entry is N, the element is skipped (only indices up to N-1 work, 
  *        so N is used to indicate that no exchange partners follow).
  * param *k_neighbours: The number of exchange partners per element.
+ * param *use_cannot_link: A boolean value (i.e., 1/0) indicating whether 
+ *       cannot-link constraints are passed via `CL_PTR` and `CL_IDX`
+ * param *CL_PTR: Array of length N+1, the cannot-link partners of element i are 
+ *       stored in CL_IDX[CL_PTR[i]], ..., CL_IDX[CL_PTR[i+1]-1]. Swaps that would
+ *       assign an element to the same cluster as one of its cannot-link partners 
+ *       are not conducted; the initial partition must satisfy the constraints.
+ * param *CL_IDX: Array of the (0-indexed) cannot-link partners.
  * 
  * The return value is assigned to the argument `clusters`, via pointer
  * 
@@ -37,7 +44,8 @@
 */
 
 void fast_kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequencies,
-        int *clusters, int *partners, int *k_neighbours) {
+        int *clusters, int *partners, int *k_neighbours,
+        int *use_cannot_link, int *CL_PTR, int *CL_IDX) {
         
         const size_t n = (size_t) *N; // number of data points
         const size_t m = (size_t) *M; // number of variables per data point
@@ -60,6 +68,9 @@ void fast_kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequ
           OBJ_BY_CLUSTER[i] = euclidean_squared(OVERALL_CENTROID, CENTERS[i], m);
         }
 
+        struct cannot_link constraints = { .PTR = CL_PTR, .IDX = CL_IDX };
+        struct cannot_link *cannot_link = *use_cannot_link ? &constraints : NULL;
+
         /* Some variables for bookkeeping during the optimization */
         size_t best_partner;
         size_t best_cluster;
@@ -97,6 +108,10 @@ void fast_kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequ
               if (cl1 == cl2) {
                 continue;
               }
+              // no swapping attempt if it violates a cannot-link constraint:
+              if (cannot_link_violated(i, j, clusters, cannot_link)) {
+                continue;
+              }
               
               // Initialize `tmp` variables for the exchange partner:
               copy_array(m, CENTERS[cl1], tmp_center1);
@@ -1,9 +1,145 @@
 // Declare Functions
 #pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "declarations.h"
+
+/* Distances used by BILS: either N x N distance matrices (for the diversity and the 
+ * dispersion), or N x M features (row major). For features, the diversity is the 
+ * average diversity based on squared Euclidean distances, and the dispersion is based 
+ * on squared Euclidean distances that are computed on demand. */
+struct bils_distances {
+  size_t N;
+  size_t M; // number of features; 0 if distance matrices are used
+  double *matrix; // diversity distances (NULL for features)
+  double *matrix2; // dispersion distances (NULL for features)
+  double *features;
+};
+
+/* Data structures that are updated during BILS to evaluate swaps quickly */
+struct bils_data {
+  double *CLUSTER_SUMS; // N x K sums of (diversity) distances between each element and each cluster
+                        // (K x M sums of the features in each cluster if features are used)
+  size_t n_sums; // length of CLUSTER_SUMS
+  struct neighbours *NN; // two nearest neighbours of each element in its cluster (dispersion distances)
+  double *CLUSTER_DISPERSIONS; // minimum (dispersion) distance within each cluster
+  size_t *MEMBERS; // all elements, ordered by cluster
+  size_t *POSITIONS; // position of each element in MEMBERS
+  size_t *CLUSTER_START; // K + 1 offsets of the clusters in MEMBERS
+};
+
+/* State of the random number generator (xoshiro256**) */
+struct rng_state {
+  uint64_t s[4];
+};
+
+/* Incumbent partition that is shared by one or more weights during the local search 
+ * using all weights */
+struct bils_track {
+  struct bils_data *data;
+  int *partition;
+  double diversity;
+  bool changed; // the partition changed during the current sweep
+  bool converged; // local maximum for the weights of this track
+};
+
+/* Data structures used by each thread during BILS */
+struct bils_worker {
+  struct bils_data *data;
+  struct pareto_archive *archive; // partitions found by the thread, merged into the global archive
+  int *partition;
+  struct bils_track *tracks; // one per weight, only used for the local search using all weights
+  size_t n_tracks;
+};
+
+/* Budget of the BILS: the search stops if the time limit or the maximum number of
+ * evaluated swaps is exceeded, or if the user interrupts. Shared by all threads. */
+enum bils_stop { BILS_RUNNING = 0, BILS_BUDGET_EXHAUSTED = 1, BILS_INTERRUPTED = 2 };
+#define BILS_INTERRUPT_INTERVAL 100000 // number of evaluations between checks for user interrupts
+
+struct bils_budget {
+  double time_limit; // in seconds; <= 0 means no limit
+  double max_evaluations; // <= 0 means no limit
+  double start;
+  double evaluations; // number of swaps evaluated so far
+  double next_interrupt_check; // only accessed by the main thread
+  int stop; // enum bils_stop
+};
+
+/* Uncolored elements for the greedy DSATUR coloring (see `color_cannot_link_graph()`),
+ * indexed by their compact index. Elements having the same number of neighbours
+ * (degree) form a class, the classes are sorted by decreasing degree. Each class has
+ * a segment in ELEMENTS, which contains the colored elements, followed by a block of
+ * uncolored elements for each saturation (decreasing), so an element changes its 
+ * block by one swap. The block of saturation s in class q is ELEMENTS[BOUNDS[OFFSET[q] 
+ * + s + 1]], ..., ELEMENTS[BOUNDS[OFFSET[q] + s] - 1]. */
+struct dsatur_queue {
+  size_t c; // number of elements having neighbours
+  size_t k; // number of clusters
+  size_t n_classes;
+  int *ELEMENTS; // compact indices, ordered by class and saturation
+  int *POSITION; // position of each element in ELEMENTS
+  int *CLASS; // class of each element
+  int *LEVELS; // highest possible saturation in each class, i.e., min(degree, k)
+  int *SEGMENT; // start of each class in ELEMENTS (n_classes + 1)
+  size_t *OFFSET; // start of the bounds of each class in BOUNDS (LEVELS[q] + 2 per class)
+  int *BOUNDS;
+  int *COUNT; // number of uncolored elements having each saturation (k + 1)
+  int max_saturation; // upper bound for the highest saturation of an uncolored element
+};
+
+/* Branch and bound search for an exact graph coloring with cluster sizes (see 
+ * `exact_coloring()`). The elements having neighbours are indexed from 0 to c-1 
+ * ("compact" indices). */
+enum coloring_status { COLORING_NONE = 0, COLORING_FOUND = 1, COLORING_STOPPED = 2, COLORING_INTERRUPTED = 3 };
+#define COLORING_INTERRUPT_INTERVAL 10000 // number of search nodes between checks for time limit and user interrupts
+
+struct coloring_search {
+  size_t c; // number of elements having neighbours
+  size_t k; // number of clusters
+  int *NODES; // element of each compact index
+  int *COMPACT; // compact index of each element (-1 for elements without neighbours)
+  int *PTR; // neighbours of element i: IDX[PTR[i]], ..., IDX[PTR[i+1] - 1]
+  int *IDX;
+  int *CAPACITIES; // size of each cluster
+  int *COLOR; // cluster of each element (compact index), -1 if not colored
+  int *COUNTS; // c x k number of neighbours of each element in each cluster
+  int *SATURATION; // number of different clusters among the neighbours of each element
+  int *FREE; // number of free places in each cluster
+  int *USED; // number of colored elements in each cluster
+  double start;
+  double time_limit; // in seconds; <= 0 means no limit
+  double visited; // number of nodes of the search tree visited so far
+  double next_interrupt_check;
+  int stop; // COLORING_NONE while the search is running, otherwise enum coloring_status
+};
+
+/* Archive of non-dominated partitions (Pareto set). The partitions are sorted by 
+ * diversity (ascending), so the dispersion is decreasing across the archive. All 
+ * partitions are stored in one block of memory with `capacity` slots of length N; 
+ * slots of removed partitions are re-used. */
+struct pareto_archive {
+  size_t N;
+  size_t size; // number of partitions in the archive
+  size_t capacity; // number of slots
+  double *DIVERSITY;
+  double *DISPERSION;
+  uint64_t *HASH; // hash value of each partition, for detecting duplicates
+  size_t *SLOT; // slot of each partition in PARTITIONS
+  int *PARTITIONS; // capacity x N
+  size_t *FREE_SLOTS; // stack of unused slots
+  size_t n_free;
+  int *LABELS; // N, working memory for relabeling a partition
+  int *RELABELED; // N, the relabeled partition that is inserted
+};
 
 void bicriterion_iterated_local_search_call(
         double *distances, 
         double *disp_distances,
+        int *use_disp_distances,
+        int *use_features,
+        double *features,
+        int *M,
         int *N, 
         int *R,
         int *upper_bound, 
@@ -14,47 +150,162 @@ void bicriterion_iterated_local_search_call(
         int *frequencies, // frequency of each partition
         int *use_init_partitions,
         int *init_partitions,
+        int *threads,
+        int *use_exchange_partners,
+        int *partners,
+        int *k_neighbours,
+        int *use_cannot_link,
+        int *CL_PTR,
+        int *CL_IDX,
+        int *all_weights,
+        double *time_limit,
+        double *max_evaluations,
         int *result,
+        double *result_diversity,
+        double *result_dispersion,
+        int *n_partitions,
+        int *stopped,
         int *mem_error
 );
-struct Pareto_element* multistart_bicriterion_pairwise_interchange(
+int multistart_bicriterion_pairwise_interchange(
+        struct pareto_archive *archive,
+        struct rng_state *rng,
+        struct bils_budget *budget,
         size_t N, 
-        double matrix[N][N], 
-        double matrix2[N][N], 
+        size_t K, 
+        struct bils_distances *distances,
         size_t R, 
         size_t WL, 
         double weights[WL], 
         int *partition, int *frequencies, int *use_init_partitions,
-        int *init_partitions
+        int *init_partitions,
+        int *partners, 
+        size_t k_partners,
+        struct cannot_link *cannot_link,
+        bool all_weights,
+        int threads
 );
 
-void shuffle_permutation(int N, int *permutation);
+void shuffle_permutation(struct rng_state *rng, int N, int *permutation);
+void perturb_partition(struct rng_state *rng, size_t N, int* partition, double neighborhood_size,
+                       struct cannot_link *cannot_link);
 
-struct Pareto_element* bicriterion_iterated_local_search(
-        struct Pareto_element* head, 
+int bicriterion_iterated_local_search(
+        struct pareto_archive *archive, 
+        struct rng_state *rng,
+        struct bils_budget *budget,
         size_t N, 
-        double matrix[N][N], 
-        double matrix2[N][N], 
+        size_t K, 
+        struct bils_distances *distances,
         size_t G, 
         size_t WL, 
         double weights[WL], 
         double neighbor_percent[2],
-        int *frequencies
+        int *frequencies,
+        int *partners, 
+        size_t k_partners,
+        struct cannot_link *cannot_link,
+        bool all_weights,
+        int threads
 );
-double sample(size_t array_size,double array[array_size]);
-double get_diversity(size_t N, int* partition, double matrix[N][N], int *frequencies);
-double get_dispersion(size_t N, int* partition, double matrix[N][N]);
+int bils_local_search(struct bils_worker *worker, struct bils_budget *budget, size_t N, 
+                      size_t K, struct bils_distances *distances, double div_weight, 
+                      int *frequencies, int *partners, size_t k_partners, 
+                      struct cannot_link *cannot_link);
+int bils_local_search_all_weights(struct bils_worker *worker, struct bils_budget *budget, 
+                                  size_t N, size_t K, struct bils_distances *distances, 
+                                  size_t WL, double weights[WL], int *frequencies, 
+                                  int *partners, size_t k_partners, 
+                                  struct cannot_link *cannot_link);
+bool bils_budget_exhausted(struct bils_budget *budget, size_t evaluations);
+bool bils_interrupt_pending(void);
+double bils_wall_time(void);
+struct bils_worker* allocate_bils_workers(int threads, size_t N, size_t K, size_t M, 
+                                          size_t n_tracks);
+void free_bils_workers(int threads, struct bils_worker *workers);
+int merge_bils_workers(struct pareto_archive *archive, int threads, struct bils_worker *workers);
+int bils_thread_id(void);
+double sample(struct rng_state *rng, size_t array_size, double array[array_size]);
+double get_diversity(size_t N, int* partition, double *matrix, int *frequencies);
 void cluster_swap(size_t i, size_t j, int* partition);
-int update_pareto(struct Pareto_element** head_ref, size_t N, int* partition, double diversity, double dispersion);
-bool paretodominated(struct Pareto_element* head, double diversity, double dispersion);
-int push(struct Pareto_element** head_ref, double diversity, double dispersion, size_t N, int* partition);
-void delete_outdated(struct Pareto_element** head_ref, double diversity, double dispersion);
-void linked_list_sample(struct Pareto_element* head, size_t N, int* partition);
-int linked_list_length(struct Pareto_element* head);
+struct pareto_archive* allocate_pareto_archive(size_t N, size_t capacity);
+void free_pareto_archive(struct pareto_archive *archive);
+int grow_pareto_archive(struct pareto_archive *archive, size_t capacity);
+int update_pareto(struct pareto_archive *archive, int* partition, double diversity, double dispersion);
+bool paretodominated(struct pareto_archive *archive, double diversity, double dispersion);
+size_t pareto_lower_bound(struct pareto_archive *archive, double diversity);
+size_t pareto_upper_bound(struct pareto_archive *archive, double diversity);
+void relabel_partition(size_t N, int* partition, int* relabeled, int* LABELS);
+uint64_t hash_partition(size_t N, int* partition);
+int pareto_results(struct pareto_archive *archive, size_t u, int *result, 
+                   double *result_diversity, double *result_dispersion);
+void pareto_sample(struct rng_state *rng, struct pareto_archive *archive, int* partition);
 double random_in_range(double min, double max);
-double get_diversity_fast(double diversity, int x,int y, size_t N, int* partition, double matrix[N][N], int *frequencies);
-double get_dispersion_fast(double dispersion, int x,int y, size_t N, int* partition, double matrix[N][N]);
-void free_pareto_set(struct Pareto_element* head);
-double uniform_rnd_number(void);
-double uni_rnd_number_range(double min, double max);
-int random_integer(int min, int max);
+double bils_diversity(size_t N, size_t K, int* partition, struct bils_distances *distances, 
+                      int *frequencies);
+double bils_diversity_change(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                             struct bils_distances *distances, struct bils_data *data, 
+                             int *frequencies);
+double bils_dispersion_distance(struct bils_distances *distances, size_t i, size_t j);
+void fill_centroid_sums(size_t N, size_t K, size_t M, int* partition, double *features, 
+                        double *CENTROID_SUMS);
+double centroid_swap_change(size_t x, size_t y, int g, int h, size_t M, double *features, 
+                            double *CENTROID_SUMS, int *frequencies);
+void update_centroid_sums(size_t x, size_t y, int g, int h, size_t M, double *features, 
+                          double *CENTROID_SUMS);
+void fill_cluster_sums(size_t N, size_t K, int* partition, double *matrix, double *CLUSTER_SUMS);
+double diversity_swap_change(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                             double *matrix, double *CLUSTER_SUMS, int *frequencies);
+void update_cluster_sums(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                         double *matrix, double *CLUSTER_SUMS);
+struct bils_data* allocate_bils_data(size_t N, size_t K, size_t M);
+void free_bils_data(struct bils_data *data);
+void copy_bils_data(size_t N, size_t K, struct bils_data *from, struct bils_data *to);
+void initialize_bils_data(size_t N, size_t K, int* partition, struct bils_distances *distances, 
+                          struct bils_data *data);
+double dispersion_swap_value(size_t x, size_t y, int g, int h, size_t K, 
+                             struct bils_distances *distances, struct bils_data *data);
+void update_bils_data(size_t x, size_t y, int g, int h, size_t N, size_t K, 
+                      struct bils_distances *distances, struct bils_data *data);
+void bils_update_neighbours(size_t N, size_t i, int c, struct bils_distances *distances, 
+                            struct bils_data *data);
+double bils_cluster_dispersion(int c, struct bils_data *data);
+double uniform_rnd_number(struct rng_state *rng);
+double uni_rnd_number_range(struct rng_state *rng, double min, double max);
+int random_integer(struct rng_state *rng, int min, int max);
+uint64_t next_random(struct rng_state *rng);
+void seed_rng(struct rng_state *rng);
+void seed_rng_from(struct rng_state *rng, uint64_t seed);
+
+// for the initial partitions of must-link anticlustering
+bool pack_must_link_groups(struct rng_state *rng, size_t g, size_t k, int *sizes,
+                           int *capacities, int *partition, int *ORDER,
+                           int *CLUSTER_ORDER, int *FREE);
+int first_fit(size_t k, int size, int *CLUSTER_ORDER, int *FREE);
+int repair_assignment(int size, int *sizes, int *partition,
+                      int *ORDER, size_t n_assigned, int *FREE);
+
+// for the initial partitions of cannot-link anticlustering
+bool color_cannot_link_graph(struct rng_state *rng, size_t n, size_t k, size_t c,
+                             int *capacities, struct cannot_link *cannot_link,
+                             int *partition, int *CONSTRAINED, int *COMPACT,
+                             struct dsatur_queue *queue, int *SATURATION, bool *BLOCKED,
+                             int *CLUSTER_ORDER, int *FREE);
+struct dsatur_queue* allocate_dsatur_queue(size_t c, size_t k, int *CONSTRAINED, int *PTR);
+void free_dsatur_queue(struct dsatur_queue *queue);
+void reset_dsatur_queue(struct dsatur_queue *queue);
+void dsatur_move_up(struct dsatur_queue *queue, size_t v, int s);
+void dsatur_raise(struct dsatur_queue *queue, size_t v, int s);
+void dsatur_remove(struct dsatur_queue *queue, size_t v, int s);
+size_t dsatur_next(struct rng_state *rng, struct dsatur_queue *queue);
+void fill_free_places(struct rng_state *rng, size_t k, size_t n_elements, int *ELEMENTS,
+                      int *partition, int *FREE);
+
+// for the exact graph coloring in optimal_dispersion()
+int coloring_branch(struct coloring_search *search, size_t n_colored);
+void set_coloring(struct coloring_search *search, size_t v, size_t h, int change);
+bool symmetric_empty_cluster(struct coloring_search *search, size_t h);
+int coloring_degree(struct coloring_search *search, size_t v);
+size_t greedy_clique_size(struct coloring_search *search, int *MARK);
+void mark_neighbours(struct coloring_search *search, size_t i, int *MARK, int change);
+bool coloring_stopped(struct coloring_search *search);
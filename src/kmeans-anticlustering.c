@@ -22,6 +22,13 @@
  * param *categories: An assignment of elements to categories,
  *         array of length *N (has to consists of integers between 0 and (C-1) 
  *         - this has to be guaranteed by the caller)
+ * param *use_cannot_link: A boolean value (i.e., 1/0) indicating whether 
+ *       cannot-link constraints are passed via `CL_PTR` and `CL_IDX`
+ * param *CL_PTR: Array of length N+1, the cannot-link partners of element i are 
+ *       stored in CL_IDX[CL_PTR[i]], ..., CL_IDX[CL_PTR[i+1]-1]. Swaps that would
+ *       assign an element to the same cluster as one of its cannot-link partners 
+ *       are not conducted; the initial partition must satisfy the constraints.
+ * param *CL_IDX: Array of the (0-indexed) cannot-link partners.
  * param *mem_error: This is passed with value 0 and only receives the value 1 
  *       if a memory error occurs when executing this function. The caller needs
  *       to test if this value is 1 after execution.
@@ -83,7 +90,8 @@
 
 void kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequencies,
         int *clusters, int *USE_CATS, int *C, int *CAT_frequencies,
-        int *categories, int *mem_error) {
+        int *categories, int *use_cannot_link, int *CL_PTR, int *CL_IDX, 
+        int *mem_error) {
         
         /* 
         * - Free strategy: each function cleans its own mess
@@ -173,6 +181,9 @@ void kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequencie
         objective_by_cluster(m, k, OBJ_BY_CLUSTER, CENTERS, CLUSTER_HEADS);
         double SUM_OBJECTIVE = array_sum(k, OBJ_BY_CLUSTER);
         
+        struct cannot_link constraints = { .PTR = CL_PTR, .IDX = CL_IDX };
+        struct cannot_link *cannot_link = *use_cannot_link ? &constraints : NULL;
+        
         /* Some variables for bookkeeping during the optimization */
         size_t best_partner;
         double tmp_centers[k][m];
@@ -204,6 +215,11 @@ void kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequencie
                         if (cl1 == cl2) { 
                                 continue;
                         }
+                        // no swapping attempt if it violates a cannot-link constraint
+                        // (`clusters` is kept up to date for this purpose):
+                        if (cannot_link_violated(i, j, clusters, cannot_link)) {
+                                continue;
+                        }
 
                         // Initialize `tmp` variables for the exchange partner:
                         copy_matrix(k, m, CENTERS, tmp_centers);
@@ -239,6 +255,7 @@ void kmeans_anticlustering(double *data, int *N, int *M, int *K, int *frequencie
                 // Only if objective is improved: Do the swap
                 if (best_obj > SUM_OBJECTIVE) {
                         swap(n, i, best_partner, PTR_NODES);
+                        fast_swap(clusters, i, best_partner);
                         // Update the "global" variables
                         SUM_OBJECTIVE = best_obj;
                         copy_matrix(k, m, best_centers, CENTERS);
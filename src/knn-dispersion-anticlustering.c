@@ -0,0 +1,286 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "declarations.h"
+
+/* Dispersion Anticlustering Based on a Nearest Neighbour Graph
+ *
+ * param *weights: The distances of the pairs in the nearest neighbour graph,
+ *         array of length *NNZ. Each pair of elements is only given once.
+ * param *row_index: The (0-indexed) first element of each pair, array of length *NNZ
+ * param *col_index: The (0-indexed) second element of each pair, array of length *NNZ
+ * param *NNZ: The number of pairs in the nearest neighbour graph
+ * param *kth_distances: For each element, the distance to its k'th nearest neighbour,
+ *         i.e., all elements that are not among its neighbours in the graph have at
+ *         least this distance. Array of length *N.
+ * param *N: The number of elements
+ * param *K: The number of clusters
+ * param *clusters: An initial assignment of elements to clusters,
+ *         array of length *N (has to consists of integers between 0 and (K-1)
+ *         - this has to be guaranteed by the caller)
+ * param *USE_CATS: A boolean value (i.e., 1/0) indicating whether categorical
+ *         constraints are used
+ * param *C: The number of categories
+ * param *categories: An assignment of elements to categories,
+ *         array of length *N (has to consists of integers between 0 and (C-1)
+ *         - this has to be guaranteed by the caller)
+ * param *dispersion: Receives the dispersion of the resulting partition, as far as
+ *         it is represented in the nearest neighbour graph
+ * param *bound: Receives a lower bound for the distances of all pairs in the
+ *         same cluster that may not be represented in the graph. If *dispersion <=
+ *         *bound, *dispersion is the actual dispersion of the partition; otherwise,
+ *         the graph has to include more neighbours.
+ * param *mem_error: This is passed with value 0 and only receives the value 1
+ *       if a memory error occurs when executing this function. The caller needs
+ *       to test if this value is 1 after execution.
+ *
+ * The return value is assigned to the argument `clusters`, via pointer
+ *
+ *
+ * ============================ Some explanations ============================
+ *
+ * Only distances that are in the graph are considered: For each element, the two
+ * nearest neighbours in its cluster (as far as they are connected in the graph) are
+ * stored, and the dispersion is the minimum distance to a nearest neighbour. As in
+ * the targeted search for the dispersion (see `dispersion_anticlustering()`), only
+ * elements that are part of a pair having the minimum distance ("critical" elements)
+ * are swapped. A swap is accepted if it does not create a pair having a lower
+ * distance and reduces the number of critical elements. When there are no
+ * critical elements left, the dispersion has increased. Evaluating a swap only
+ * requires to inspect the graph neighbours of the two swapped elements. For each
+ * critical element, the first swap that is accepted is conducted.
+ * ===========================================================================
+*/
+
+void knn_dispersion_anticlustering(double *weights, int *row_index, int *col_index, int *NNZ,
+                                   double *kth_distances, int *N, int *K, int *clusters,
+                                   int *USE_CATS, int *C, int *categories,
+                                   double *dispersion, double *bound, int *mem_error) {
+
+        const size_t n = (size_t) *N; // number of data points
+        const size_t k = (size_t) *K; // number of clusters
+        const size_t nnz = (size_t) *NNZ; // number of pairs in the graph
+        const size_t c = number_of_categories(USE_CATS, C);
+
+        size_t *ADJ_PTR = (size_t*) calloc(n + 1, sizeof(size_t));
+        size_t *ADJ_IDX = (size_t*) malloc(sizeof(size_t) * (2 * nnz + 1)); // + 1: nnz may be 0
+        double *ADJ_WEIGHTS = (double*) malloc(sizeof(double) * (2 * nnz + 1));
+        struct neighbours *NN = (struct neighbours*) malloc(sizeof(struct neighbours) * n);
+        double *TMP_DISTANCES = (double*) malloc(sizeof(double) * n);
+        int *TOUCHED = (int*) calloc(n, sizeof(int));
+        size_t *CAT_PTR = (size_t*) calloc(c + 1, sizeof(size_t));
+        size_t *CAT_IDX = (size_t*) malloc(sizeof(size_t) * n);
+
+        if (ADJ_PTR == NULL || ADJ_IDX == NULL || ADJ_WEIGHTS == NULL || NN == NULL ||
+            TMP_DISTANCES == NULL || TOUCHED == NULL || CAT_PTR == NULL || CAT_IDX == NULL) {
+                free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(NN);
+                free(TMP_DISTANCES); free(TOUCHED); free(CAT_PTR); free(CAT_IDX);
+                *mem_error = 1;
+                return;
+        }
+
+        if (fill_adjacency_list(n, nnz, weights, row_index, col_index, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS) == 1) {
+                free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(NN);
+                free(TMP_DISTANCES); free(TOUCHED); free(CAT_PTR); free(CAT_IDX);
+                *mem_error = 1;
+                return;
+        }
+        fill_category_index(n, c, USE_CATS, categories, CAT_PTR, CAT_IDX);
+
+        for (size_t i = 0; i < n; i++) {
+                knn_update_neighbours(n, i, clusters, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, NN);
+        }
+        size_t n_critical;
+        double OBJECTIVE = knn_dispersion(n, NN, &n_critical);
+
+        /* Targeted search: repeat until no critical element can be swapped */
+        int improvement_occured = 1;
+        size_t offset = 0; // varies the first exchange partner that is tested
+        while (improvement_occured) {
+                improvement_occured = 0;
+                for (size_t i = 0; i < n; i++) {
+                        if (NN[i].first_distance != OBJECTIVE) {
+                                continue;
+                        }
+                        size_t category_i = *USE_CATS ? (size_t) categories[i] : 0;
+                        size_t n_partners = CAT_PTR[category_i + 1] - CAT_PTR[category_i];
+                        for (size_t u = 0; u < n_partners; u++) {
+                                size_t j = CAT_IDX[CAT_PTR[category_i] + (offset + u) % n_partners];
+                                if (clusters[i] == clusters[j]) {
+                                        continue;
+                                }
+                                int change = knn_critical_change(
+                                        i, j, OBJECTIVE, clusters, ADJ_PTR, ADJ_IDX,
+                                        ADJ_WEIGHTS, NN, TMP_DISTANCES, TOUCHED
+                                );
+                                if (change < 0) {
+                                        knn_swap(
+                                                n, i, j, clusters, ADJ_PTR, ADJ_IDX,
+                                                ADJ_WEIGHTS, NN, TOUCHED
+                                        );
+                                        n_critical -= (size_t) (-change);
+                                        if (n_critical == 0) {
+                                                OBJECTIVE = knn_dispersion(n, NN, &n_critical);
+                                        }
+                                        improvement_occured = 1;
+                                        offset += u + 1;
+                                        break;
+                                }
+                        }
+                }
+        }
+
+        // Lower bound for the distances that are not in the graph: If an element has
+        // a neighbour in its cluster that is nearer than its k'th nearest neighbour,
+        // its actual nearest neighbour in the cluster is known
+        int CLUSTER_SIZES[k];
+        for (size_t i = 0; i < k; i++) {
+                CLUSTER_SIZES[i] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+                CLUSTER_SIZES[clusters[i]]++;
+        }
+        *bound = INFINITY;
+        for (size_t i = 0; i < n; i++) {
+                if (CLUSTER_SIZES[clusters[i]] > 1 &&
+                    NN[i].first_distance > kth_distances[i] && kth_distances[i] < *bound) {
+                        *bound = kth_distances[i];
+                }
+        }
+        *dispersion = OBJECTIVE;
+
+        free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(NN);
+        free(TMP_DISTANCES); free(TOUCHED); free(CAT_PTR); free(CAT_IDX);
+}
+
+/* Compute the change in the number of critical elements (i.e., elements whose
+ * nearest neighbour has distance `dispersion`) when swapping elements i and j.
+ * Returns 0 if the swap creates a pair having a distance lower than `dispersion`.
+ * Only the graph neighbours of i and j (and i and j themselves) are affected by
+ * the swap. `TMP_DISTANCES` and `TOUCHED` are work arrays of length n,
+ * `TOUCHED` must only contain zeros (and is reset before returning).
+ */
+int knn_critical_change(size_t i, size_t j, double dispersion, int *clusters,
+                        size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                        struct neighbours *NN, double *TMP_DISTANCES, int *TOUCHED) {
+        int cl1 = clusters[i];
+        int cl2 = clusters[j];
+        size_t swapped[2] = {i, j};
+        int to[2] = {cl2, cl1};
+
+        // (a) Nearest neighbour distances of i and j after the swap
+        int change = 0;
+        int too_near = 0;
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                double distance = INFINITY;
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        size_t w = ADJ_IDX[u];
+                        if (w != swapped[1 - a] && clusters[w] == to[a] && ADJ_WEIGHTS[u] < distance) {
+                                distance = ADJ_WEIGHTS[u];
+                        }
+                }
+                if (distance < dispersion) {
+                        return 0;
+                }
+                change += (distance == dispersion) - (NN[v].first_distance == dispersion);
+        }
+
+        // (b) Neighbours of i and j in the two clusters lose one element and may gain
+        //     the other element
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        size_t w = ADJ_IDX[u];
+                        if (TOUCHED[w] || w == i || w == j || (clusters[w] != cl1 && clusters[w] != cl2)) {
+                                continue;
+                        }
+                        TOUCHED[w] = 1;
+                        size_t removed = clusters[w] == cl1 ? i : j;
+                        TMP_DISTANCES[w] = NN[w].first == removed ?
+                                NN[w].second_distance : NN[w].first_distance;
+                }
+        }
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        size_t w = ADJ_IDX[u];
+                        if (TOUCHED[w] && clusters[w] == to[a] && ADJ_WEIGHTS[u] < TMP_DISTANCES[w]) {
+                                TMP_DISTANCES[w] = ADJ_WEIGHTS[u];
+                        }
+                }
+        }
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        size_t w = ADJ_IDX[u];
+                        if (!TOUCHED[w]) {
+                                continue;
+                        }
+                        TOUCHED[w] = 0;
+                        if (TMP_DISTANCES[w] < dispersion) {
+                                too_near = 1;
+                        }
+                        change += (TMP_DISTANCES[w] == dispersion) - (NN[w].first_distance == dispersion);
+                }
+        }
+        return too_near ? 0 : change;
+}
+
+/* Swap elements i and j and update the nearest neighbours of all elements that are
+ * affected (i.e., i, j, and their graph neighbours) */
+void knn_swap(size_t n, size_t i, size_t j, int *clusters, size_t *ADJ_PTR, size_t *ADJ_IDX,
+              double *ADJ_WEIGHTS, struct neighbours *NN, int *TOUCHED) {
+        fast_swap(clusters, i, j);
+        knn_update_neighbours(n, i, clusters, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, NN);
+        knn_update_neighbours(n, j, clusters, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, NN);
+        size_t swapped[2] = {i, j};
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        size_t w = ADJ_IDX[u];
+                        if (TOUCHED[w] || w == i || w == j) {
+                                continue;
+                        }
+                        TOUCHED[w] = 1;
+                        knn_update_neighbours(n, w, clusters, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, NN);
+                }
+        }
+        for (size_t a = 0; a < 2; a++) {
+                size_t v = swapped[a];
+                for (size_t u = ADJ_PTR[v]; u < ADJ_PTR[v + 1]; u++) {
+                        TOUCHED[ADJ_IDX[u]] = 0;
+                }
+        }
+}
+
+// Recompute the two nearest neighbours of element `i` in its cluster (only using the graph)
+void knn_update_neighbours(size_t n, size_t i, int *clusters, size_t *ADJ_PTR, size_t *ADJ_IDX,
+                           double *ADJ_WEIGHTS, struct neighbours *NN) {
+        NN[i].first = n;
+        NN[i].second = n;
+        NN[i].first_distance = INFINITY;
+        NN[i].second_distance = INFINITY;
+        for (size_t u = ADJ_PTR[i]; u < ADJ_PTR[i + 1]; u++) {
+                if (clusters[ADJ_IDX[u]] == clusters[i]) {
+                        insert_neighbour(&NN[i], ADJ_IDX[u], ADJ_WEIGHTS[u]);
+                }
+        }
+}
+
+// Compute the dispersion from the nearest neighbours, and the number of critical elements
+double knn_dispersion(size_t n, struct neighbours *NN, size_t *n_critical) {
+        double min = INFINITY;
+        *n_critical = 0;
+        for (size_t i = 0; i < n; i++) {
+                if (NN[i].first_distance < min) {
+                        min = NN[i].first_distance;
+                        *n_critical = 0;
+                }
+                if (NN[i].first_distance == min) {
+                        (*n_critical)++;
+                }
+        }
+        return min;
+}
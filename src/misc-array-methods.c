@@ -1,4 +1,5 @@
 #include <stdlib.h> 
+#include <math.h>
 
 
 /* Copy one array into another */
@@ -26,6 +27,17 @@ double array_sum(size_t k, double ARRAY[k]) {
         return sum;
 }
 
+/* Compute the minimum of an array */
+double array_min(size_t k, double ARRAY[k]) {
+        double min = INFINITY;
+        for (size_t i = 0; i < k; i++) {
+                if (ARRAY[i] < min) {
+                        min = ARRAY[i];
+                }
+        }
+        return min;
+}
+
 /* Compute the weighted sum of an array, by multiplication */
 double weighted_array_sum(size_t k, int* frequencies, double ARRAY[k]) {
         double sum = 0;
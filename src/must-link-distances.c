@@ -0,0 +1,74 @@
+
+#include <math.h>
+#include <stdlib.h>
+#include "declarations.h"
+
+/* Aggregate distances for must-link anticlustering
+ *
+ * For must-link anticlustering, each must-link group is treated as a single unit;
+ * the "distance" between two groups is the sum of the distances between their members
+ * (the sum of the within-group distances is stored on the diagonal, where each pair
+ * is counted twice, as in the full distance matrix).
+ *
+ * param *data: Either an N x N distance matrix (column major) or an N x M feature
+ *         matrix (passed row wise, i.e., the M features of element i are stored in
+ *         data[i * M], ..., data[i * M + M - 1]). For features, Euclidean distances
+ *         are computed on the fly, so no N x N matrix is needed.
+ * param *N: The number of elements
+ * param *M: The number of features (not used for distance input)
+ * param *use_distances: A boolean value (i.e., 1/0) indicating whether `data` is
+ *         a distance matrix
+ * param *groups: The must-link group of each element, array of length *N (has
+ *         to consist of integers between 0 and (N_reduced-1) - this has to be
+ *         guaranteed by the caller)
+ * param *N_reduced: The number of must-link groups
+ * param *result: Array of length *N_reduced x *N_reduced that receives the
+ *         aggregated distances (column major); it has to be initialized with 0
+ *
+ * Each pair of elements is only visited once (the distances are symmetric). For
+ * features, the pairs are visited in blocks of `MUST_LINK_BLOCK` x `MUST_LINK_BLOCK`
+ * elements, so the features of both blocks remain in the cache.
+ */
+
+#define MUST_LINK_BLOCK 128
+
+void must_link_distances(double *data, int *N, int *M, int *use_distances, int *groups,
+                         int *N_reduced, double *result) {
+        const size_t n = (size_t) *N;
+        const size_t m = (size_t) *M;
+        const size_t nr = (size_t) *N_reduced;
+
+        if (*use_distances) {
+                for (size_t j = 0; j < n; j++) {
+                        size_t gj = groups[j];
+                        result[gj * nr + gj] += data[j * n + j];
+                        for (size_t i = j + 1; i < n; i++) {
+                                add_group_distance(groups[i], gj, nr, data[j * n + i], result);
+                        }
+                }
+                return;
+        }
+
+        for (size_t start_i = 0; start_i < n; start_i += MUST_LINK_BLOCK) {
+                size_t end_i = start_i + MUST_LINK_BLOCK < n ? start_i + MUST_LINK_BLOCK : n;
+                for (size_t start_j = start_i; start_j < n; start_j += MUST_LINK_BLOCK) {
+                        size_t end_j = start_j + MUST_LINK_BLOCK < n ? start_j + MUST_LINK_BLOCK : n;
+                        for (size_t i = start_i; i < end_i; i++) {
+                                // within the diagonal block, only pairs j > i are used
+                                size_t first_j = start_j > i + 1 ? start_j : i + 1;
+                                for (size_t j = first_j; j < end_j; j++) {
+                                        double distance = sqrt(euclidean_squared(
+                                                &data[i * m], &data[j * m], m
+                                        ));
+                                        add_group_distance(groups[i], groups[j], nr, distance, result);
+                                }
+                        }
+                }
+        }
+}
+
+// Add the distance between two elements to the aggregated distances of their groups
+void add_group_distance(size_t g, size_t h, size_t nr, double distance, double *result) {
+        result[g * nr + h] += distance;
+        result[h * nr + g] += distance;
+}
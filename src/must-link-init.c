@@ -0,0 +1,184 @@
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "header.h"
+
+/* Initial partitions for must-link anticlustering
+ *
+ * Each must-link group has to be assigned to one cluster as a whole, without
+ * exceeding the cluster sizes (this is a bin packing problem). The groups are
+ * assigned in order of decreasing size (groups having the same size are assigned in
+ * random order); each group is assigned to the first cluster that has enough free
+ * capacity, visiting the clusters in random order. If a group does not fit into any
+ * cluster, two groups that were already assigned are exchanged between clusters to
+ * make room (repair step); if this fails as well, the assignment is restarted (at
+ * most `MUST_LINK_INIT_ATTEMPTS` times per partition). Groups of size 1 always fit
+ * (they are assigned last), so they fill the remaining capacity at random.
+ *
+ * param *sizes: The size of each must-link group (groups of size 1 are not
+ *         restricted), array of length *G
+ * param *G: The number of groups
+ * param *K: The number of clusters
+ * param *capacities: The size of each cluster, array of length *K (the sum of the
+ *         capacities has to be equal to the sum of the group sizes - this has to be
+ *         guaranteed by the caller)
+ * param *R: The number of initial partitions that are generated
+ * param *result: Array of length *R x *G that receives the partitions (one after
+ *         another), as cluster labels between 0 and (K-1); a partition where the
+ *         groups could not be assigned receives the label -1 for all groups
+ * param *n_failed: Receives the number of partitions that could not be generated
+ * param *mem_error: This is passed with value 0 and only receives the value 1
+ *       if a memory error occurs when executing this function. The caller needs
+ *       to test if this value is 1 after execution.
+ *
+ * Random numbers are generated in C (see `seed_rng()`), so R's RNG is only
+ * called once.
+ */
+
+#define MUST_LINK_INIT_ATTEMPTS 10
+
+void must_link_init_partitions(int *sizes, int *G, int *K, int *capacities, int *R,
+                               int *result, int *n_failed, int *mem_error) {
+        const size_t g = (size_t) *G;
+        const size_t k = (size_t) *K;
+
+        int *ORDER = (int*) malloc(sizeof(int) * g);
+        int *CLUSTER_ORDER = (int*) malloc(sizeof(int) * k);
+        int *FREE = (int*) malloc(sizeof(int) * k);
+        if (ORDER == NULL || CLUSTER_ORDER == NULL || FREE == NULL) {
+                free(ORDER);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                *mem_error = 1;
+                return;
+        }
+
+        // Sort groups by decreasing size (counting sort, the sizes are at most N)
+        size_t max_size = 0;
+        for (size_t i = 0; i < g; i++) {
+                if ((size_t) sizes[i] > max_size) {
+                        max_size = sizes[i];
+                }
+        }
+        size_t *START = (size_t*) calloc(max_size + 1, sizeof(size_t));
+        if (START == NULL) {
+                free(ORDER);
+                free(CLUSTER_ORDER);
+                free(FREE);
+                *mem_error = 1;
+                return;
+        }
+        for (size_t i = 0; i < g; i++) {
+                START[sizes[i]]++;
+        }
+        // START[s] becomes the position of the first group of size s
+        size_t position = 0;
+        for (size_t s = max_size + 1; s > 0; s--) {
+                size_t count = START[s - 1];
+                START[s - 1] = position;
+                position += count;
+        }
+        for (size_t i = 0; i < g; i++) {
+                ORDER[START[sizes[i]]++] = i;
+        }
+        free(START);
+
+        struct rng_state rng;
+        seed_rng(&rng);
+
+        *n_failed = 0;
+        for (size_t r = 0; r < (size_t) *R; r++) {
+                int *partition = result + r * g;
+                bool success = false;
+                for (int attempt = 0; attempt < MUST_LINK_INIT_ATTEMPTS && !success; attempt++) {
+                        success = pack_must_link_groups(&rng, g, k, sizes, capacities, partition,
+                                                        ORDER, CLUSTER_ORDER, FREE);
+                }
+                if (!success) {
+                        for (size_t i = 0; i < g; i++) {
+                                partition[i] = -1;
+                        }
+                        (*n_failed)++;
+                }
+        }
+
+        free(ORDER);
+        free(CLUSTER_ORDER);
+        free(FREE);
+}
+
+// One attempt of assigning all groups to clusters (see above), the groups are
+// processed in the order given by `ORDER`, which is sorted by decreasing size.
+// Returns true if all groups were assigned
+bool pack_must_link_groups(struct rng_state *rng, size_t g, size_t k, int *sizes,
+                           int *capacities, int *partition, int *ORDER,
+                           int *CLUSTER_ORDER, int *FREE) {
+        // random order of groups having the same size
+        size_t start = 0;
+        while (start < g) {
+                size_t end = start;
+                while (end < g && sizes[ORDER[end]] == sizes[ORDER[start]]) {
+                        end++;
+                }
+                shuffle_permutation(rng, end - start, ORDER + start);
+                start = end;
+        }
+        for (size_t c = 0; c < k; c++) {
+                FREE[c] = capacities[c];
+                CLUSTER_ORDER[c] = c;
+        }
+        for (size_t u = 0; u < g; u++) {
+                size_t i = ORDER[u];
+                shuffle_permutation(rng, k, CLUSTER_ORDER);
+                int cluster = first_fit(k, sizes[i], CLUSTER_ORDER, FREE);
+                if (cluster == -1) {
+                        cluster = repair_assignment(sizes[i], sizes, partition, ORDER, u, FREE);
+                }
+                if (cluster == -1) {
+                        return false;
+                }
+                partition[i] = cluster;
+                FREE[cluster] -= sizes[i];
+        }
+        return true;
+}
+
+// Return the first cluster (in the order given by `CLUSTER_ORDER`) that has at
+// least `size` free places, or -1 if there is no such cluster
+int first_fit(size_t k, int size, int *CLUSTER_ORDER, int *FREE) {
+        for (size_t c = 0; c < k; c++) {
+                if (FREE[CLUSTER_ORDER[c]] >= size) {
+                        return CLUSTER_ORDER[c];
+                }
+        }
+        return -1;
+}
+
+// Make room for a group of size `size` by exchanging two of the groups that were
+// already assigned (the first `n_assigned` groups in `ORDER`): a group j in cluster a
+// is exchanged with a smaller group l in cluster b, so that cluster a has enough free
+// places afterwards (and cluster b does not exceed its size). Returns cluster a, or
+// -1 if no such exchange exists
+int repair_assignment(int size, int *sizes, int *partition,
+                      int *ORDER, size_t n_assigned, int *FREE) {
+        for (size_t u = 0; u < n_assigned; u++) {
+                size_t j = ORDER[u];
+                int a = partition[j];
+                for (size_t v = 0; v < n_assigned; v++) {
+                        size_t l = ORDER[v];
+                        int b = partition[l];
+                        int difference = sizes[j] - sizes[l];
+                        if (a == b || difference <= 0) {
+                                continue;
+                        }
+                        if (FREE[a] + difference >= size && FREE[b] >= difference) {
+                                partition[j] = b;
+                                partition[l] = a;
+                                FREE[a] += difference;
+                                FREE[b] -= difference;
+                                return a;
+                        }
+                }
+        }
+        return -1;
+}
@@ -0,0 +1,139 @@
+
+#include <stdlib.h>
+#include "declarations.h"
+
+/* Exchange Method for K-Means Anticlustering with Must-Link Constraints
+ *
+ * Each must-link group is collapsed into one "super element" that is represented
+ * by the sum of the feature values of its members. Super elements are only swapped
+ * with super elements of the same size, so the cluster sizes do not change.
+ *
+ * param *sums: vector of feature sums (N x M, passed row wise, i.e., the M feature
+ *         sums of super element i are stored in sums[i * M], ..., sums[i * M + M - 1])
+ * param *N: The number of super elements
+ * param *M: The number of features
+ * param *K: The number of clusters
+ * param *frequencies: The number of elements (not super elements) per cluster,
+ *         i.e., an array of length *K.
+ * param *clusters: An initial assignment of super elements to clusters,
+ *         array of length *N (has to consists of integers between 0 and (K-1)
+ *         - this has to be guaranteed by the caller)
+ * param *C: The number of different sizes of the super elements
+ * param *sizes: The size of each super element, coded as integers between
+ *         0 and (C-1), array of length *N; only super elements of the same size
+ *         are swapped.
+ * param *local_maximum: Use local maximum search instead of default exchange method
+ *       that terminates after one iteration through the data set
+ * param *mem_error: This is passed with value 0 and only receives the value 1
+ *       if a memory error occurs when executing this function. The caller needs
+ *       to test if this value is 1 after execution.
+ *
+ * The return value is assigned to the argument `clusters`, via pointer
+ *
+ * ============================ Some explanations ============================
+ *
+ * Maximizing the k-means objective (i.e., the sum of squared Euclidean distances
+ * between elements and their cluster centroids) is equivalent to minimizing
+ * sum_k ||S_k||^2 / n_k when the cluster sizes n_k are fixed, where S_k is the sum
+ * of the feature values in cluster k. When the super elements i (in cluster g) and
+ * j (in cluster h) are swapped, only S_g and S_h change by d = s_j - s_i, so the
+ * change in the objective is computed in O(M) from the cluster sums. The memory
+ * is linear in the number of super elements.
+ * ===========================================================================
+ */
+
+void must_link_kmeans_anticlustering(double *sums, int *N, int *M, int *K, int *frequencies,
+                                     int *clusters, int *C, int *sizes, int *local_maximum,
+                                     int *mem_error) {
+
+        const size_t n = (size_t) *N;
+        const size_t m = (size_t) *M;
+        const size_t k = (size_t) *K;
+        const size_t c = (size_t) *C;
+
+        double *CLUSTER_SUMS = (double*) calloc(k * m, sizeof(double));
+        size_t *SIZE_PTR = (size_t*) calloc(c + 1, sizeof(size_t));
+        size_t *SIZE_IDX = (size_t*) malloc(sizeof(size_t) * n);
+        if (CLUSTER_SUMS == NULL || SIZE_PTR == NULL || SIZE_IDX == NULL) {
+                free(CLUSTER_SUMS);
+                free(SIZE_PTR);
+                free(SIZE_IDX);
+                *mem_error = 1;
+                return;
+        }
+
+        // Exchange partners: all super elements having the same size
+        int use_sizes = 1;
+        fill_category_index(n, c, &use_sizes, sizes, SIZE_PTR, SIZE_IDX);
+
+        for (size_t i = 0; i < n; i++) {
+                double *sums_cluster = CLUSTER_SUMS + clusters[i] * m;
+                for (size_t u = 0; u < m; u++) {
+                        sums_cluster[u] += sums[i * m + u];
+                }
+        }
+
+        int improvement_occured = 1;
+        while (improvement_occured) {
+                improvement_occured = 0;
+                for (size_t i = 0; i < n; i++) {
+                        int g = clusters[i];
+                        size_t size_i = sizes[i];
+                        // this is a minimization problem, only swaps with a negative
+                        // change are conducted
+                        double best_change = 0;
+                        size_t best_partner = i;
+                        for (size_t v = SIZE_PTR[size_i]; v < SIZE_PTR[size_i + 1]; v++) {
+                                size_t j = SIZE_IDX[v];
+                                int h = clusters[j];
+                                if (g == h) {
+                                        continue;
+                                }
+                                double change = centroid_sums_swap_change(
+                                        i, j, m, sums, CLUSTER_SUMS + g * m, CLUSTER_SUMS + h * m,
+                                        frequencies[g], frequencies[h]
+                                );
+                                if (change < best_change) {
+                                        best_change = change;
+                                        best_partner = j;
+                                }
+                        }
+
+                        // Only if objective is improved: Do the swap
+                        if (best_partner != i) {
+                                size_t j = best_partner;
+                                int h = clusters[j];
+                                double *sums_g = CLUSTER_SUMS + g * m;
+                                double *sums_h = CLUSTER_SUMS + h * m;
+                                for (size_t u = 0; u < m; u++) {
+                                        double d = sums[j * m + u] - sums[i * m + u];
+                                        sums_g[u] += d;
+                                        sums_h[u] -= d;
+                                }
+                                fast_swap(clusters, i, j);
+                                if (*local_maximum) {
+                                        improvement_occured = 1;
+                                }
+                        }
+                }
+        }
+
+        free(CLUSTER_SUMS);
+        free(SIZE_PTR);
+        free(SIZE_IDX);
+}
+
+/* Change in sum_k ||S_k||^2 / n_k when the super elements i (in cluster g) and
+ * j (in cluster h) are swapped; `sums_g` and `sums_h` are the feature sums of
+ * clusters g and h, `n_g` and `n_h` their sizes. */
+double centroid_sums_swap_change(size_t i, size_t j, size_t m, double *sums,
+                                 double *sums_g, double *sums_h, int n_g, int n_h) {
+        double change_g = 0;
+        double change_h = 0;
+        for (size_t u = 0; u < m; u++) {
+                double d = sums[j * m + u] - sums[i * m + u];
+                change_g += d * (2 * sums_g[u] + d);
+                change_h += d * (d - 2 * sums_h[u]);
+        }
+        return change_g / n_g + change_h / n_h;
+}
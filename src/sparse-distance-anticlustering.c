@@ -0,0 +1,310 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "declarations.h"
+
+/* Exchange Method for Anticlustering Based on a Sparse Distance / Similarity Matrix
+ *
+ * param *weights: The nonzero entries of a symmetric matrix, array of length *NNZ.
+ *         Each pair of elements is only given once (pairs that are not given
+ *         have a value of 0).
+ * param *row_index: The (0-indexed) first element of each pair, array of length *NNZ
+ * param *col_index: The (0-indexed) second element of each pair, array of length *NNZ
+ * param *NNZ: The number of pairs having a nonzero value
+ * param *N: The number of elements
+ * param *K: The number of clusters
+ * param *frequencies: The number of elements per cluster, i.e., an array
+ *         of length *K. See `distance_anticlustering()`.
+ * param *clusters: An initial assignment of elements to clusters,
+ *         array of length *N (has to consists of integers between 0 and (K-1)
+ *         - this has to be guaranteed by the caller)
+ *
+ * All other parameters have the same meaning as in `distance_anticlustering()`.
+ *
+ * The return value is assigned to the argument `clusters`, via pointer
+ *
+ *
+ * ============================ Some explanations ============================
+ *
+ * The diversity is computed only over the pairs that are stored. To this end,
+ * the sparse matrix is turned into an adjacency list (`ADJ_PTR`, `ADJ_IDX`,
+ * `ADJ_WEIGHTS`, i.e., compressed sparse row format). Additionally, an N x K
+ * table `SUMS_TO_CLUSTERS` stores for each element the sum of its values
+ * to the elements in each cluster. Using this table, the change in diversity
+ * that is caused by a swap is computed in constant time; after a swap, the
+ * table is updated by iterating through the adjacency lists of the two
+ * swapped elements. Thus, memory is O(NNZ + N * K) instead of O(N^2).
+ * ===========================================================================
+*/
+
+void sparse_distance_anticlustering(double *weights, int *row_index, int *col_index, int *NNZ,
+                                    int *N, int *K, int *frequencies, int *clusters,
+                                    int *USE_CATS, int *C, int *categories,
+                                    int *local_maximum, int *R,
+                                    int *use_init_partitions, int *init_partitions,
+                                    int *use_exchange_partners, int *partners, int *k_neighbours,
+                                    int *mem_error) {
+
+        const size_t n = (size_t) *N; // number of data points
+        const size_t k = (size_t) *K; // number of clusters
+        const size_t nnz = (size_t) *NNZ; // number of pairs with nonzero value
+
+        // Set up adjacency list, each pair is stored twice (i.e., for both elements)
+        size_t *ADJ_PTR = (size_t*) calloc(n + 1, sizeof(size_t));
+        size_t *ADJ_IDX = (size_t*) malloc(sizeof(size_t) * (2 * nnz + 1)); // + 1: nnz may be 0
+        double *ADJ_WEIGHTS = (double*) malloc(sizeof(double) * (2 * nnz + 1));
+        double *SUMS_TO_CLUSTERS = (double*) malloc(sizeof(double) * n * k);
+        double *ROW_I = (double*) calloc(n, sizeof(double)); // dense copy of one row of the matrix
+        size_t *CAT_PTR = (size_t*) calloc(number_of_categories(USE_CATS, C) + 1, sizeof(size_t));
+        size_t *CAT_IDX = (size_t*) malloc(sizeof(size_t) * n);
+        int *BEST_PARTITION = (int*) malloc(sizeof(int) * n);
+
+        if (ADJ_PTR == NULL || ADJ_IDX == NULL || ADJ_WEIGHTS == NULL ||
+            SUMS_TO_CLUSTERS == NULL || ROW_I == NULL || CAT_PTR == NULL ||
+            CAT_IDX == NULL || BEST_PARTITION == NULL) {
+                free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(SUMS_TO_CLUSTERS);
+                free(ROW_I); free(CAT_PTR); free(CAT_IDX); free(BEST_PARTITION);
+                *mem_error = 1;
+                return;
+        }
+
+        if (fill_adjacency_list(n, nnz, weights, row_index, col_index, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS) == 1) {
+                free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(SUMS_TO_CLUSTERS);
+                free(ROW_I); free(CAT_PTR); free(CAT_IDX); free(BEST_PARTITION);
+                *mem_error = 1;
+                return;
+        }
+
+        // Deal with categorical restrictions
+        size_t c = number_of_categories(USE_CATS, C);
+        fill_category_index(n, c, USE_CATS, categories, CAT_PTR, CAT_IDX);
+
+        // outer optimization loop, across repetitions (where the initial partition varies)
+        double BEST_OBJ = -INFINITY;
+        size_t partition_counter = 0;
+        for (size_t a = 0; a < *R; a++) {
+                if (*use_init_partitions == 1) {
+                        for (size_t i = 0; i < n; i++) {
+                              clusters[i] = init_partitions[partition_counter];
+                              partition_counter++;
+                        }
+                }
+
+                double OBJ_RESULT = sparse_distance_anticlustering_(
+                        n, k, clusters, frequencies, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS,
+                        SUMS_TO_CLUSTERS, ROW_I, CAT_PTR, CAT_IDX, USE_CATS, categories,
+                        local_maximum, use_exchange_partners, partners, k_neighbours
+                );
+
+                if (OBJ_RESULT > BEST_OBJ) {
+                        for (size_t i = 0; i < n; i++) {
+                                BEST_PARTITION[i] = clusters[i];
+                        }
+                        BEST_OBJ = OBJ_RESULT;
+                }
+        }
+
+        // Write output
+        for (size_t i = 0; i < n; i++) {
+                clusters[i] = BEST_PARTITION[i];
+        }
+
+        free(ADJ_PTR); free(ADJ_IDX); free(ADJ_WEIGHTS); free(SUMS_TO_CLUSTERS);
+        free(ROW_I); free(CAT_PTR); free(CAT_IDX); free(BEST_PARTITION);
+}
+
+// This function actually implements the exchange method (and the local maximum search),
+// returns the objective of the partition that is written to `clusters`
+double sparse_distance_anticlustering_(size_t n, size_t k, int *clusters, int *frequencies,
+                                       size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                                       double *SUMS_TO_CLUSTERS, double *ROW_I,
+                                       size_t *CAT_PTR, size_t *CAT_IDX,
+                                       int *USE_CATS, int *categories, int *local_maximum,
+                                       int *use_exchange_partners, int *partners, int *k_neighbours) {
+
+        // Initialize sums of values from each element to each cluster
+        for (size_t i = 0; i < n * k; i++) {
+                SUMS_TO_CLUSTERS[i] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+                for (size_t u = ADJ_PTR[i]; u < ADJ_PTR[i + 1]; u++) {
+                        SUMS_TO_CLUSTERS[i * k + clusters[ADJ_IDX[u]]] += ADJ_WEIGHTS[u];
+                }
+        }
+
+        // Initialize objective (each pair is counted twice in `SUMS_TO_CLUSTERS`)
+        double OBJ_BY_CLUSTER[k];
+        for (size_t i = 0; i < k; i++) {
+                OBJ_BY_CLUSTER[i] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+                OBJ_BY_CLUSTER[clusters[i]] += SUMS_TO_CLUSTERS[i * k + clusters[i]] / 2;
+        }
+        double SUM_OBJECTIVE = weighted_array_sum2(k, frequencies, OBJ_BY_CLUSTER);
+
+        /* Start main iteration loop for exchange procedure */
+        /* 0. level: test if  local maximum was found */
+        int improvement_occured = 1;
+        while (improvement_occured) {
+                improvement_occured = 0;
+                /* 1. Level: Iterate through `n` data points */
+                for (size_t i = 0; i < n; i++) {
+                        size_t cl1 = clusters[i];
+                        double *sums_i = SUMS_TO_CLUSTERS + i * k;
+
+                        // Dense copy of the values of element i, for looking up d_ij
+                        for (size_t u = ADJ_PTR[i]; u < ADJ_PTR[i + 1]; u++) {
+                                ROW_I[ADJ_IDX[u]] = ADJ_WEIGHTS[u];
+                        }
+
+                        // Initialize `best` variables for the i'th item
+                        double best_delta = 0;
+                        size_t best_partner = i;
+
+                        /* 2. Level: Iterate through the exchange partners */
+                        size_t category_i = *USE_CATS ? (size_t) categories[i] : 0;
+                        size_t n_partners = CAT_PTR[category_i + 1] - CAT_PTR[category_i];
+                        if (*use_exchange_partners) {
+                                n_partners = (size_t) *k_neighbours;
+                        }
+                        for (size_t u = 0; u < n_partners; u++) {
+                                // recode exchange partner index
+                                size_t j;
+                                if (*use_exchange_partners) {
+                                        j = partners[i * n_partners + u];
+                                        if (j == n) { // no exchange partners any more
+                                                continue;
+                                        }
+                                        // partners must also respect categorical constraints
+                                        if (*USE_CATS && categories[j] != category_i) {
+                                                continue;
+                                        }
+                                } else {
+                                        j = CAT_IDX[CAT_PTR[category_i] + u];
+                                }
+                                size_t cl2 = clusters[j];
+                                // no swapping attempt if in the same cluster:
+                                if (cl1 == cl2) {
+                                        continue;
+                                }
+                                double *sums_j = SUMS_TO_CLUSTERS + j * k;
+
+                                // Cluster 1 loses the values of element i and gains
+                                // the values of j (without the value d_ij);
+                                // Cluster 2 loses j and gains i
+                                double delta =
+                                        (sums_j[cl1] - ROW_I[j] - sums_i[cl1]) / frequencies[cl1] +
+                                        (sums_i[cl2] - ROW_I[j] - sums_j[cl2]) / frequencies[cl2];
+
+                                // Update `best` variables if objective was improved
+                                if (delta > best_delta) {
+                                        best_delta = delta;
+                                        best_partner = j;
+                                }
+                        }
+
+                        // Only if objective is improved: Do the swap
+                        if (best_delta > 0) {
+                                size_t j = best_partner;
+                                size_t cl2 = clusters[j];
+                                double *sums_j = SUMS_TO_CLUSTERS + j * k;
+                                if (*local_maximum) {
+                                        improvement_occured = 1;
+                                }
+                                // Update the "global" variables
+                                OBJ_BY_CLUSTER[cl1] += sums_j[cl1] - ROW_I[j] - sums_i[cl1];
+                                OBJ_BY_CLUSTER[cl2] += sums_i[cl2] - ROW_I[j] - sums_j[cl2];
+                                SUM_OBJECTIVE = weighted_array_sum2(k, frequencies, OBJ_BY_CLUSTER);
+                                update_sums_to_clusters(i, cl1, cl2, k, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, SUMS_TO_CLUSTERS);
+                                update_sums_to_clusters(j, cl2, cl1, k, ADJ_PTR, ADJ_IDX, ADJ_WEIGHTS, SUMS_TO_CLUSTERS);
+                                fast_swap(clusters, i, j);
+                        }
+
+                        // Reset dense copy of element i
+                        for (size_t u = ADJ_PTR[i]; u < ADJ_PTR[i + 1]; u++) {
+                                ROW_I[ADJ_IDX[u]] = 0;
+                        }
+                }
+        }
+
+        return SUM_OBJECTIVE;
+}
+
+/* Set up adjacency list (compressed sparse row format) from a list of pairs
+ *
+ * After calling this function, the neighbours of element `i` are stored in
+ * `ADJ_IDX[ADJ_PTR[i]], ..., ADJ_IDX[ADJ_PTR[i+1] - 1]` and the associated
+ * values in `ADJ_WEIGHTS`. `ADJ_PTR` must be initialized with zeros and
+ * has length n + 1; `ADJ_IDX` and `ADJ_WEIGHTS` have length 2 * nnz.
+ * Returns 1 if a memory allocation error occurred, 0 otherwise.
+ */
+int fill_adjacency_list(size_t n, size_t nnz, double *weights, int *row_index, int *col_index,
+                         size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS) {
+        for (size_t u = 0; u < nnz; u++) {
+                ADJ_PTR[row_index[u] + 1]++;
+                ADJ_PTR[col_index[u] + 1]++;
+        }
+        for (size_t i = 0; i < n; i++) {
+                ADJ_PTR[i + 1] += ADJ_PTR[i];
+        }
+        // `fill` tracks the next free position for each element
+        size_t *fill = (size_t*) malloc(sizeof(size_t) * (n + 1));
+        if (fill == NULL) {
+                return 1;
+        }
+        for (size_t i = 0; i < n; i++) {
+                fill[i] = ADJ_PTR[i];
+        }
+        for (size_t u = 0; u < nnz; u++) {
+                size_t i = row_index[u];
+                size_t j = col_index[u];
+                ADJ_IDX[fill[i]] = j;
+                ADJ_WEIGHTS[fill[i]] = weights[u];
+                fill[i]++;
+                ADJ_IDX[fill[j]] = i;
+                ADJ_WEIGHTS[fill[j]] = weights[u];
+                fill[j]++;
+        }
+        free(fill);
+        return 0;
+}
+
+/* Set up the indices of the elements by category (compressed format):
+ * `CAT_IDX[CAT_PTR[c]], ..., CAT_IDX[CAT_PTR[c+1] - 1]` are the indices of the 
+ * elements having category `c`. `CAT_PTR` must be initialized with zeros and
+ * has length c + 1; `CAT_IDX` has length n. If no categories are used, 
+ * all elements have category 0.
+ */
+void fill_category_index(size_t n, size_t c, int *USE_CATS, int *categories, 
+                         size_t *CAT_PTR, size_t *CAT_IDX) {
+        for (size_t i = 0; i < n; i++) {
+                size_t category_i = *USE_CATS ? (size_t) categories[i] : 0;
+                CAT_PTR[category_i + 1]++;
+        }
+        for (size_t i = 0; i < c; i++) {
+                CAT_PTR[i + 1] += CAT_PTR[i];
+        }
+        // `CAT_PTR[category]` is used as the next free position, and is restored afterwards
+        for (size_t i = 0; i < n; i++) {
+                size_t category_i = *USE_CATS ? (size_t) categories[i] : 0;
+                CAT_IDX[CAT_PTR[category_i]] = i;
+                CAT_PTR[category_i]++;
+        }
+        for (size_t i = c; i > 0; i--) {
+                CAT_PTR[i] = CAT_PTR[i - 1];
+        }
+        CAT_PTR[0] = 0;
+}
+
+/* After element `i` has moved from cluster `from` to cluster `to`, update the
+ * sums of values to clusters for all neighbours of `i` */
+void update_sums_to_clusters(size_t i, size_t from, size_t to, size_t k,
+                             size_t *ADJ_PTR, size_t *ADJ_IDX, double *ADJ_WEIGHTS,
+                             double *SUMS_TO_CLUSTERS) {
+        for (size_t u = ADJ_PTR[i]; u < ADJ_PTR[i + 1]; u++) {
+                double *sums_neighbour = SUMS_TO_CLUSTERS + ADJ_IDX[u] * k;
+                sums_neighbour[from] -= ADJ_WEIGHTS[u];
+                sums_neighbour[to] += ADJ_WEIGHTS[u];
+        }
+}